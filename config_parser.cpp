@@ -154,6 +154,22 @@ bool ConfigParser::hasKey(const std::string& section, const std::string& key) {
     return section_it->second.find(key) != section_it->second.end();
 }
 
+std::vector<std::string> ConfigParser::getSections() const {
+    std::vector<std::string> sections;
+    for (const auto& section_pair : config_data_) {
+        sections.push_back(section_pair.first);
+    }
+    return sections;
+}
+
+std::map<std::string, std::string> ConfigParser::getSection(const std::string& section) const {
+    auto section_it = config_data_.find(section);
+    if (section_it == config_data_.end()) {
+        return std::map<std::string, std::string>();
+    }
+    return section_it->second;
+}
+
 void ConfigParser::printConfig() {
     std::cout << "=== Configuration ===" << std::endl;
     for (const auto& section_pair : config_data_) {
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -34,6 +35,12 @@ public:
     // 检查配置项是否存在
     bool hasKey(const std::string& section, const std::string& key);
     
+    // 获取所有节名
+    std::vector<std::string> getSections() const;
+    
+    // 获取节内所有键值对，节不存在时返回空
+    std::map<std::string, std::string> getSection(const std::string& section) const;
+    
     // 打印所有配置
     void printConfig();
 
@@ -0,0 +1,333 @@
+#include "flv_index.h"
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// 索引文件格式(小端):
+//   文件头32字节: "FLVI" | 版本u32 | 源文件大小u64 | 源mtime秒i64 | 源mtime纳秒u32 | 条目数u32
+//   条目18字节:   偏移u64 | 时间戳u32 | 数据大小u32 | 类型u8 | 标志u8
+static const char INDEX_MAGIC[4] = {'F', 'L', 'V', 'I'};
+static const uint32_t INDEX_VERSION = 1;
+static const size_t INDEX_HEADER_SIZE = 32;
+static const size_t INDEX_ENTRY_SIZE = 18;
+
+static void putLE(uint8_t* p, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint64_t getLE(const uint8_t* p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+FLVIndex::FLVIndex()
+    : source_size_(0)
+    , source_mtime_sec_(0)
+    , source_mtime_nsec_(0) {
+}
+
+std::string FLVIndex::indexPath(const std::string& flv_path) {
+    return flv_path + ".idx";
+}
+
+uint8_t FLVIndex::classifyTag(const FLVTagView& tag) {
+    if (tag.type == 18) {
+        return FLV_INDEX_METADATA;
+    }
+    if (tag.data_size == 0) {
+        return 0;
+    }
+
+    uint8_t header = tag.data[0];
+
+    if (tag.type == 9) {
+        uint8_t frame_type = (header >> 4) & 0x07;
+        if (header & 0x80) {
+            // Enhanced RTMP: 0=SequenceStart，1=CodedFrames，3=CodedFramesX
+            uint8_t packet_type = header & 0x0F;
+            if (packet_type == 0) {
+                return FLV_INDEX_SEQUENCE_HEADER;
+            }
+            return (frame_type == 1 && (packet_type == 1 || packet_type == 3)) ? FLV_INDEX_KEYFRAME : 0;
+        }
+
+        uint8_t codec_id = header & 0x0F;
+        if (codec_id == 7 || codec_id == 12) {
+            if (tag.data_size < 2) {
+                return 0;
+            }
+            if (tag.data[1] == 0) {
+                return FLV_INDEX_SEQUENCE_HEADER;
+            }
+            return (frame_type == 1 && tag.data[1] == 1) ? FLV_INDEX_KEYFRAME : 0;
+        }
+        return frame_type == 1 ? FLV_INDEX_KEYFRAME : 0;
+    }
+
+    if (tag.type == 8) {
+        uint8_t sound_format = header >> 4;
+        if (sound_format == 10 && tag.data_size >= 2 && tag.data[1] == 0) {
+            return FLV_INDEX_SEQUENCE_HEADER;       // AAC AudioSpecificConfig
+        }
+        if (sound_format == 9 && (header & 0x0F) == 0) {
+            return FLV_INDEX_SEQUENCE_HEADER;       // Enhanced RTMP音频SequenceStart
+        }
+    }
+
+    return 0;
+}
+
+bool FLVIndex::statSource(const std::string& flv_path, uint64_t& size, int64_t& mtime_sec, uint32_t& mtime_nsec) const {
+    struct stat st;
+    if (stat(flv_path.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_sec = st.st_mtim.tv_sec;
+    mtime_nsec = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+bool FLVIndex::build(const std::string& flv_path) {
+    entries_.clear();
+
+    if (!statSource(flv_path, source_size_, source_mtime_sec_, source_mtime_nsec_)) {
+        return false;
+    }
+
+    FLVReader reader;
+    if (!reader.open(flv_path)) {
+        return false;
+    }
+
+    // 只访问标签头和负载的前两个字节
+    FLVTagView tag;
+    while (reader.next(tag)) {
+        FLVIndexEntry entry;
+        entry.offset = tag.offset;
+        entry.timestamp = tag.timestamp;
+        entry.data_size = tag.data_size;
+        entry.type = tag.type;
+        entry.flags = classifyTag(tag);
+        entries_.push_back(entry);
+    }
+
+    return true;
+}
+
+bool FLVIndex::load(const std::string& index_path, const std::string& flv_path) {
+    entries_.clear();
+
+    uint64_t size;
+    int64_t mtime_sec;
+    uint32_t mtime_nsec;
+    if (!statSource(flv_path, size, mtime_sec, mtime_nsec)) {
+        return false;
+    }
+
+    FILE* file = fopen(index_path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    uint8_t header[INDEX_HEADER_SIZE];
+    bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+                 memcmp(header, INDEX_MAGIC, 4) == 0 &&
+                 getLE(header + 4, 4) == INDEX_VERSION &&
+                 getLE(header + 8, 8) == size &&
+                 static_cast<int64_t>(getLE(header + 16, 8)) == mtime_sec &&
+                 getLE(header + 24, 4) == mtime_nsec;
+
+    if (valid) {
+        uint32_t count = static_cast<uint32_t>(getLE(header + 28, 4));
+        std::vector<uint8_t> data(static_cast<size_t>(count) * INDEX_ENTRY_SIZE);
+        valid = fread(data.data(), 1, data.size(), file) == data.size();
+
+        if (valid) {
+            entries_.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint8_t* p = data.data() + static_cast<size_t>(i) * INDEX_ENTRY_SIZE;
+                FLVIndexEntry& entry = entries_[i];
+                entry.offset = getLE(p, 8);
+                entry.timestamp = static_cast<uint32_t>(getLE(p + 8, 4));
+                entry.data_size = static_cast<uint32_t>(getLE(p + 12, 4));
+                entry.type = p[16];
+                entry.flags = p[17];
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (!valid) {
+        entries_.clear();
+        return false;
+    }
+
+    source_size_ = size;
+    source_mtime_sec_ = mtime_sec;
+    source_mtime_nsec_ = mtime_nsec;
+    return true;
+}
+
+bool FLVIndex::save(const std::string& index_path) const {
+    std::vector<uint8_t> data(INDEX_HEADER_SIZE + entries_.size() * INDEX_ENTRY_SIZE);
+
+    memcpy(data.data(), INDEX_MAGIC, 4);
+    putLE(data.data() + 4, INDEX_VERSION, 4);
+    putLE(data.data() + 8, source_size_, 8);
+    putLE(data.data() + 16, static_cast<uint64_t>(source_mtime_sec_), 8);
+    putLE(data.data() + 24, source_mtime_nsec_, 4);
+    putLE(data.data() + 28, entries_.size(), 4);
+
+    uint8_t* p = data.data() + INDEX_HEADER_SIZE;
+    for (const auto& entry : entries_) {
+        putLE(p, entry.offset, 8);
+        putLE(p + 8, entry.timestamp, 4);
+        putLE(p + 12, entry.data_size, 4);
+        p[16] = entry.type;
+        p[17] = entry.flags;
+        p += INDEX_ENTRY_SIZE;
+    }
+
+    // 先写临时文件再重命名，其他进程不会读到写了一半的索引
+    std::string temp_path = index_path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = (fclose(file) == 0) && written;
+
+    if (!written || rename(temp_path.c_str(), index_path.c_str()) != 0) {
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FLVIndex::loadOrBuild(const std::string& flv_path) {
+    std::string index_path = indexPath(flv_path);
+    if (load(index_path, flv_path)) {
+        return true;
+    }
+    if (!build(flv_path)) {
+        return false;
+    }
+    // 保存失败(如目录只读)不影响本次使用
+    save(index_path);
+    return true;
+}
+
+bool FLVIndex::findClipStart(uint32_t start_ms, FLVClipStart& clip) const {
+    if (entries_.empty()) {
+        return false;
+    }
+
+    uint32_t target = firstTimestamp() + start_ms;
+
+    // 按文件顺序扫描，记录到每个位置为止最近的元数据和序列头
+    const FLVIndexEntry* metadata = nullptr;
+    const FLVIndexEntry* video_header = nullptr;
+    const FLVIndexEntry* audio_header = nullptr;
+
+    const FLVIndexEntry* start = nullptr;
+    const FLVIndexEntry* start_headers[3] = {nullptr, nullptr, nullptr};
+    const FLVIndexEntry* fallback = nullptr;
+    const FLVIndexEntry* fallback_headers[3] = {nullptr, nullptr, nullptr};
+    bool has_keyframes = false;
+
+    for (const auto& entry : entries_) {
+        if (entry.flags & FLV_INDEX_METADATA) {
+            if (!metadata) {
+                metadata = &entry;
+            }
+            continue;
+        }
+        if (entry.flags & FLV_INDEX_SEQUENCE_HEADER) {
+            (entry.type == 9 ? video_header : audio_header) = &entry;
+            continue;
+        }
+
+        if (entry.flags & FLV_INDEX_KEYFRAME) {
+            has_keyframes = true;
+            if (entry.timestamp > target) {
+                break;
+            }
+            start = &entry;
+            start_headers[0] = metadata;
+            start_headers[1] = video_header;
+            start_headers[2] = audio_header;
+        } else if (!has_keyframes && entry.timestamp <= target) {
+            // 纯音频文件按普通标签定位
+            fallback = &entry;
+            fallback_headers[0] = metadata;
+            fallback_headers[1] = video_header;
+            fallback_headers[2] = audio_header;
+        }
+    }
+
+    if (!start && !has_keyframes) {
+        start = fallback;
+        memcpy(start_headers, fallback_headers, sizeof(start_headers));
+    }
+
+    clip.header_offsets.clear();
+    if (!start) {
+        // 目标早于第一个关键帧，从头开始
+        clip.offset = entries_.front().offset;
+        clip.timestamp = entries_.front().timestamp;
+        return true;
+    }
+
+    for (const FLVIndexEntry* header : start_headers) {
+        if (header) {
+            clip.header_offsets.push_back(header->offset);
+        }
+    }
+    std::sort(clip.header_offsets.begin(), clip.header_offsets.end());
+    clip.offset = start->offset;
+    clip.timestamp = start->timestamp;
+    return true;
+}
+
+bool FLVIndex::findResumeStart(uint64_t offset, FLVClipStart& clip) const {
+    const FLVIndexEntry* headers[3] = {nullptr, nullptr, nullptr};
+    for (const auto& entry : entries_) {
+        if (entry.offset > offset) {
+            break;
+        }
+        if (entry.offset == offset) {
+            clip.header_offsets.clear();
+            for (const FLVIndexEntry* header : headers) {
+                if (header) {
+                    clip.header_offsets.push_back(header->offset);
+                }
+            }
+            std::sort(clip.header_offsets.begin(), clip.header_offsets.end());
+            clip.offset = entry.offset;
+            clip.timestamp = entry.timestamp;
+            return true;
+        }
+        if ((entry.flags & FLV_INDEX_METADATA) && !headers[0]) {
+            headers[0] = &entry;
+        } else if (entry.flags & FLV_INDEX_SEQUENCE_HEADER) {
+            headers[entry.type == 9 ? 1 : 2] = &entry;
+        }
+    }
+    return false;
+}
+
+const std::vector<FLVIndexEntry>& FLVIndex::entries() const {
+    return entries_;
+}
+
+uint32_t FLVIndex::firstTimestamp() const {
+    return entries_.empty() ? 0 : entries_.front().timestamp;
+}
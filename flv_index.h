@@ -0,0 +1,68 @@
+#ifndef FLV_INDEX_H
+#define FLV_INDEX_H
+
+#include "flv_reader.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 索引条目标志
+enum FLVIndexFlags {
+    FLV_INDEX_KEYFRAME = 0x01,          // 视频关键帧(不含序列头)
+    FLV_INDEX_SEQUENCE_HEADER = 0x02,   // AVC/HEVC/AAC序列头
+    FLV_INDEX_METADATA = 0x04           // 脚本数据(onMetaData)
+};
+
+struct FLVIndexEntry {
+    uint64_t offset;        // 标签头在文件中的偏移
+    uint32_t timestamp;
+    uint32_t data_size;
+    uint8_t type;
+    uint8_t flags;
+};
+
+// 片段推送的起始位置：先发送header_offsets中的标签，再从offset处的关键帧开始
+struct FLVClipStart {
+    std::vector<uint64_t> header_offsets;   // onMetaData和最近的音视频序列头，按文件顺序
+    uint64_t offset = 0;
+    uint32_t timestamp = 0;
+};
+
+// FLV标签索引：记录每个标签的位置、时间戳、类型、大小和关键帧标志，
+// 保存为FLV文件旁边的紧凑二进制文件(<flv>.idx)，用于直接定位到指定时间点。
+// 索引文件记录FLV文件的大小和修改时间，源文件变化后自动失效。
+class FLVIndex {
+public:
+    FLVIndex();
+
+    // 扫描FLV文件生成索引
+    bool build(const std::string& flv_path);
+
+    bool load(const std::string& index_path, const std::string& flv_path);
+    bool save(const std::string& index_path) const;
+
+    // 优先加载旁路索引文件，不存在或已失效时重新生成并保存
+    bool loadOrBuild(const std::string& flv_path);
+
+    // 查找start_ms(相对首个标签时间戳)之前最近的关键帧；没有视频关键帧时从第一个标签开始
+    bool findClipStart(uint32_t start_ms, FLVClipStart& clip) const;
+
+    // 从offset处的标签(检查点记录的关键帧)开始，补发其之前最近的元数据和序列头；offset不是标签起点时返回false
+    bool findResumeStart(uint64_t offset, FLVClipStart& clip) const;
+
+    const std::vector<FLVIndexEntry>& entries() const;
+    uint32_t firstTimestamp() const;
+
+    static std::string indexPath(const std::string& flv_path);
+    static uint8_t classifyTag(const FLVTagView& tag);
+
+private:
+    bool statSource(const std::string& flv_path, uint64_t& size, int64_t& mtime_sec, uint32_t& mtime_nsec) const;
+
+    std::vector<FLVIndexEntry> entries_;
+    uint64_t source_size_;
+    int64_t source_mtime_sec_;
+    uint32_t source_mtime_nsec_;
+};
+
+#endif // FLV_INDEX_H
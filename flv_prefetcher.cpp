@@ -0,0 +1,190 @@
+#include "flv_prefetcher.h"
+#include <algorithm>
+
+static const uint64_t FLV_TAG_OVERHEAD = 11 + 4;     // 标签头和PreviousTagSize
+
+// 每次补充最多读入的字节数，读入期间不持有锁
+static const uint64_t MAX_CHUNK_BYTES = 1024 * 1024;
+// 预读范围的字节上限，防止时间戳异常的文件被整个读入
+static const uint64_t MAX_AHEAD_BYTES = 64 * 1024 * 1024;
+
+FLVPrefetcher::FLVPrefetcher()
+    : running_(false)
+    , waiting_(false)
+    , read_ahead_ms_(0)
+    , reader_(nullptr)
+    , read_offset_(0)
+    , read_end_(0)
+    , read_timestamp_(0)
+    , seeked_(false)
+    , ahead_reader_(nullptr)
+    , ahead_offset_(0)
+    , ahead_timestamp_(0)
+    , ahead_eof_(false)
+    , ahead_primed_(false)
+    , low_buffer_(false)
+    , low_buffer_events_(0) {
+}
+
+FLVPrefetcher::~FLVPrefetcher() {
+    stop();
+}
+
+bool FLVPrefetcher::start(uint32_t read_ahead_ms) {
+    stop();
+
+    read_ahead_ms_ = read_ahead_ms;
+    reader_ = nullptr;
+    read_end_ = 0;
+    seeked_ = false;
+    ahead_reader_ = nullptr;
+    ahead_eof_ = false;
+    ahead_primed_ = false;
+    low_buffer_ = false;
+    low_buffer_events_ = 0;
+    running_ = true;
+
+    try {
+        thread_ = std::thread(&FLVPrefetcher::threadFunc, this);
+    } catch (const std::system_error&) {
+        running_ = false;
+        return false;
+    }
+    return true;
+}
+
+void FLVPrefetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wakeup_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool FLVPrefetcher::isRunning() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+bool FLVPrefetcher::needRestartLocked() const {
+    return reader_ && (seeked_ || ahead_reader_ != reader_ || read_offset_ > ahead_offset_);
+}
+
+int64_t FLVPrefetcher::bufferedLocked() const {
+    if (!reader_ || needRestartLocked() || ahead_offset_ == read_offset_) {
+        return 0;
+    }
+    return std::max<int64_t>(0, static_cast<int32_t>(ahead_timestamp_ - read_timestamp_));
+}
+
+void FLVPrefetcher::update(const FLVReader* reader, const FLVTagView& tag) {
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+
+        bool sequential = reader == reader_ && tag.offset == read_end_;
+        uint64_t tag_end = tag.offset + FLV_TAG_OVERHEAD + tag.data_size;
+
+        // 非顺序读取(切换文件、片段定位、单文件循环回到开头)时重新开始预读
+        if (!sequential) {
+            seeked_ = true;
+        }
+        reader_ = reader;
+        read_offset_ = tag.offset;
+        read_end_ = tag_end;
+        read_timestamp_ = tag.timestamp;
+
+        // 顺序读取的标签数据超出预读范围：预读没有跟上
+        bool underrun = sequential && ahead_primed_ && ahead_reader_ == reader && tag_end > ahead_offset_;
+        if (underrun && !low_buffer_) {
+            low_buffer_events_++;
+        }
+        low_buffer_ = underrun;
+
+        // 缓冲量降到一半以下时唤醒预读线程，避免每个标签都通知
+        notify = waiting_ && (needRestartLocked() ||
+                              (!ahead_eof_ && bufferedLocked() < read_ahead_ms_ / 2));
+    }
+    if (notify) {
+        wakeup_.notify_one();
+    }
+}
+
+void FLVPrefetcher::threadFunc() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (running_) {
+        // 读取线程切换到新文件(或定位)后从其读取位置重新开始
+        if (needRestartLocked()) {
+            seeked_ = false;
+            ahead_reader_ = reader_;
+            ahead_offset_ = read_offset_;
+            ahead_timestamp_ = read_timestamp_;
+            ahead_eof_ = false;
+            ahead_primed_ = false;
+        }
+
+        bool full = !ahead_reader_ || ahead_eof_ ||
+                    bufferedLocked() >= read_ahead_ms_ ||
+                    ahead_offset_ - read_offset_ >= MAX_AHEAD_BYTES;
+        if (full) {
+            if (ahead_reader_) {
+                ahead_primed_ = true;
+            }
+            waiting_ = true;
+            wakeup_.wait(lock);
+            waiting_ = false;
+            continue;
+        }
+
+        const FLVReader* reader = ahead_reader_;
+        uint64_t start = ahead_offset_;
+        uint32_t target = read_timestamp_ + read_ahead_ms_;
+        lock.unlock();
+
+        // 按标签边界确定本次读入的范围，解析标签头本身也在本线程触发缺页
+        uint64_t end = start;
+        uint32_t timestamp = 0;
+        bool eof = false;
+        FLVTagView tag;
+        while (end - start < MAX_CHUNK_BYTES) {
+            if (!reader->tagAt(end, tag)) {
+                eof = true;
+                break;
+            }
+            end = tag.offset + FLV_TAG_OVERHEAD + tag.data_size;
+            timestamp = tag.timestamp;
+            if (static_cast<int32_t>(timestamp - target) >= 0) {
+                break;
+            }
+        }
+        if (end > start) {
+            reader->populate(start, end - start);
+        }
+
+        lock.lock();
+        if (ahead_reader_ == reader && ahead_offset_ == start) {
+            ahead_offset_ = end;
+            if (end > start) {
+                ahead_timestamp_ = timestamp;
+            }
+            ahead_eof_ = eof;
+        }
+    }
+}
+
+uint64_t FLVPrefetcher::lowBufferEvents() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return low_buffer_events_;
+}
+
+uint32_t FLVPrefetcher::bufferedMs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<uint32_t>(bufferedLocked());
+}
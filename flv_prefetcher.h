@@ -0,0 +1,67 @@
+#ifndef FLV_PREFETCHER_H
+#define FLV_PREFETCHER_H
+
+#include "flv_reader.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <cstdint>
+
+// FLV预读线程：在独立线程上把读取位置之后read_ahead_ms媒体时长的数据读入页缓存
+// 并建立映射(MADV_POPULATE_READ)。发送线程访问这些数据时不再缺页，
+// 慢速磁盘、网络文件系统或冷文件的读取延迟不会直接变成推流停顿。
+// - 缓冲量低于一半时重新补充，每次最多读入MAX_CHUNK_BYTES
+// - 顺序读取时读取位置追上预读位置记为一次缓冲不足事件
+// - 只跟随当前文件，切换文件或定位后从新的读取位置重新开始；
+//   文件衔接处仍由FLVSource提前预读下一个文件的开头
+// 读取器必须在stop()之后才能关闭。
+class FLVPrefetcher {
+public:
+    FLVPrefetcher();
+    ~FLVPrefetcher();
+
+    bool start(uint32_t read_ahead_ms);
+    void stop();
+    bool isRunning() const;
+
+    // 读取线程每读出一个标签调用一次，timestamp为文件中的原始时间戳
+    void update(const FLVReader* reader, const FLVTagView& tag);
+
+    uint64_t lowBufferEvents() const;
+    uint32_t bufferedMs() const;
+
+private:
+    FLVPrefetcher(const FLVPrefetcher&);
+    FLVPrefetcher& operator=(const FLVPrefetcher&);
+
+    void threadFunc();
+    bool needRestartLocked() const;
+    int64_t bufferedLocked() const;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    bool running_;
+    bool waiting_;
+    uint32_t read_ahead_ms_;
+
+    // 读取位置(读取线程更新)
+    const FLVReader* reader_;
+    uint64_t read_offset_;
+    uint64_t read_end_;             // 上一个标签的结束位置，用于判断是否顺序读取
+    uint32_t read_timestamp_;
+    bool seeked_;                   // 读取位置发生跳转，预读需要从新位置重新开始
+
+    // 预读位置(预读线程更新)，从读取位置到ahead_offset_的范围已在内存中
+    const FLVReader* ahead_reader_;
+    uint64_t ahead_offset_;
+    uint32_t ahead_timestamp_;
+    bool ahead_eof_;
+    bool ahead_primed_;             // 缓冲已经达到过目标量，之后的追上才算缓冲不足
+
+    bool low_buffer_;
+    uint64_t low_buffer_events_;
+};
+
+#endif // FLV_PREFETCHER_H
@@ -0,0 +1,179 @@
+#include "flv_reader.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <algorithm>
+
+// FLV文件头至少9字节，随后是4字节的PreviousTagSize0
+static const size_t FLV_HEADER_SIZE = 9;
+static const size_t FLV_TAG_HEADER_SIZE = 11;
+static const size_t FLV_PREV_TAG_SIZE = 4;
+
+static inline uint32_t readUint24(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+}
+
+FLVReader::FLVReader()
+    : base_(nullptr)
+    , size_(0)
+    , position_(0)
+    , first_tag_offset_(0) {
+}
+
+FLVReader::~FLVReader() {
+    close();
+}
+
+bool FLVReader::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        last_error_ = "Failed to open FLV file: " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        last_error_ = "FLV source is not a regular file: " + path;
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size < FLV_HEADER_SIZE + FLV_PREV_TAG_SIZE) {
+        last_error_ = "Invalid FLV file header: " + path;
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // 映射建立后不再需要文件描述符
+    if (mapping == MAP_FAILED) {
+        last_error_ = "Failed to mmap FLV file: " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    // 推流按时间顺序读取整个文件：加大预读，已读过的页可以尽早回收
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    const uint8_t* header = static_cast<const uint8_t*>(mapping);
+    uint32_t data_offset = (static_cast<uint32_t>(header[5]) << 24) | (header[6] << 16) |
+                           (header[7] << 8) | header[8];
+    if (header[0] != 'F' || header[1] != 'L' || header[2] != 'V' ||
+        data_offset < FLV_HEADER_SIZE || data_offset + FLV_PREV_TAG_SIZE > size) {
+        munmap(mapping, size);
+        last_error_ = "Invalid FLV file header: " + path;
+        return false;
+    }
+
+    base_ = header;
+    size_ = size;
+    first_tag_offset_ = data_offset + FLV_PREV_TAG_SIZE;
+    position_ = first_tag_offset_;
+    last_error_.clear();
+    return true;
+}
+
+void FLVReader::close() {
+    if (base_) {
+        munmap(const_cast<uint8_t*>(base_), size_);
+        base_ = nullptr;
+    }
+    size_ = 0;
+    position_ = 0;
+    first_tag_offset_ = 0;
+}
+
+bool FLVReader::isOpen() const {
+    return base_ != nullptr;
+}
+
+bool FLVReader::next(FLVTagView& tag) {
+    if (!tagAt(position_, tag)) {
+        return false;
+    }
+
+    // 最后一个标签可能缺少PreviousTagSize
+    position_ = std::min(size_, position_ + FLV_TAG_HEADER_SIZE + tag.data_size + FLV_PREV_TAG_SIZE);
+    return true;
+}
+
+bool FLVReader::tagAt(uint64_t offset, FLVTagView& tag) const {
+    if (!base_ || offset > size_ || size_ - offset < FLV_TAG_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint8_t* header = base_ + offset;
+    uint32_t data_size = readUint24(header + 1);
+
+    // 文件末尾被截断的标签视为文件结束
+    if (size_ - offset - FLV_TAG_HEADER_SIZE < data_size) {
+        return false;
+    }
+
+    tag.type = header[0];
+    tag.data_size = data_size;
+    tag.timestamp = readUint24(header + 4) | (static_cast<uint32_t>(header[7]) << 24);
+    tag.stream_id = readUint24(header + 8);
+    tag.data = header + FLV_TAG_HEADER_SIZE;
+    tag.offset = offset;
+    return true;
+}
+
+bool FLVReader::seek(uint64_t offset) {
+    if (!base_ || offset < first_tag_offset_ || offset > size_) {
+        return false;
+    }
+    position_ = static_cast<size_t>(offset);
+    return true;
+}
+
+void FLVReader::prefetch(uint64_t offset, uint64_t length) {
+    if (!base_ || offset >= size_) {
+        return;
+    }
+
+    // madvise要求起始地址按页对齐
+    static const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = offset & ~(page_size - 1);
+    uint64_t end = std::min<uint64_t>(size_, offset + length);
+    madvise(const_cast<uint8_t*>(base_) + start, end - start, MADV_WILLNEED);
+}
+
+void FLVReader::populate(uint64_t offset, uint64_t length) const {
+    if (!base_ || offset >= size_) {
+        return;
+    }
+
+    static const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = offset & ~(page_size - 1);
+    uint64_t end = std::min<uint64_t>(size_, offset + length);
+
+#ifdef MADV_POPULATE_READ
+    if (madvise(const_cast<uint8_t*>(base_) + start, end - start, MADV_POPULATE_READ) == 0) {
+        return;
+    }
+#endif
+
+    // 内核不支持MADV_POPULATE_READ(5.14之前)时逐页读取一个字节触发缺页
+    volatile uint8_t sink = 0;
+    for (uint64_t page = start; page < end; page += page_size) {
+        sink = sink + base_[page];
+    }
+}
+
+uint64_t FLVReader::position() const {
+    return position_;
+}
+
+uint64_t FLVReader::fileSize() const {
+    return size_;
+}
+
+const std::string& FLVReader::lastError() const {
+    return last_error_;
+}
@@ -0,0 +1,62 @@
+#ifndef FLV_READER_H
+#define FLV_READER_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// FLV标签视图：标签头字段加上指向映射区域的负载指针，不持有数据。
+// 负载在产生它的FLVReader关闭(或析构)之前有效。
+struct FLVTagView {
+    uint8_t type = 0;
+    uint32_t data_size = 0;
+    uint32_t timestamp = 0;         // 已合并扩展时间戳
+    uint32_t stream_id = 0;
+    const uint8_t* data = nullptr;
+    uint64_t offset = 0;            // 标签头在文件中的偏移
+};
+
+// 基于mmap的FLV文件读取器。整个文件只读映射到内存并提示内核顺序访问，
+// 读取标签时不发生拷贝和内存分配，媒体数据从页缓存直接进入socket发送。
+// 推流期间替换文件应使用重命名，原地截断正在映射的文件会导致访问越界(SIGBUS)。
+class FLVReader {
+public:
+    FLVReader();
+    ~FLVReader();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // 读取下一个标签，文件结束或标签不完整时返回false
+    bool next(FLVTagView& tag);
+
+    // 定位到指定偏移处的标签头，偏移必须来自FLVTagView::offset
+    bool seek(uint64_t offset);
+
+    // 解析指定偏移处的标签，不改变读取位置；可以在其他线程调用
+    bool tagAt(uint64_t offset, FLVTagView& tag) const;
+
+    // 提示内核提前读入[offset, offset + length)范围的数据
+    void prefetch(uint64_t offset, uint64_t length);
+
+    // 同步把[offset, offset + length)范围读入页缓存并建立映射，之后访问不再缺页。
+    // 可能阻塞在磁盘I/O上，由预读线程调用
+    void populate(uint64_t offset, uint64_t length) const;
+
+    uint64_t position() const;
+    uint64_t fileSize() const;
+    const std::string& lastError() const;
+
+private:
+    FLVReader(const FLVReader&);
+    FLVReader& operator=(const FLVReader&);
+
+    const uint8_t* base_;
+    size_t size_;
+    size_t position_;
+    size_t first_tag_offset_;
+    std::string last_error_;
+};
+
+#endif // FLV_READER_H
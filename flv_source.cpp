@@ -0,0 +1,410 @@
+#include "flv_source.h"
+#include "flv_index.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+// 当前文件剩余数据少于该值时预读下一个文件的开头
+static const uint64_t PREFETCH_BYTES = 8 * 1024 * 1024;
+
+// 文件衔接时使用的帧间隔范围(毫秒)
+static const uint32_t DEFAULT_INTERVAL_MS = 40;
+static const uint32_t MAX_INTERVAL_MS = 1000;
+
+FLVSource::FLVSource()
+    : resuming_(false)
+    , item_index_(0)
+    , current_(nullptr)
+    , header_pos_(0)
+    , item_has_media_(false)
+    , prefetched_(false)
+    , loops_completed_(0)
+    , items_started_(0)
+    , failed_in_row_(0)
+    , started_(false)
+    , shift_(0)
+    , last_output_(-1)
+    , last_interval_(DEFAULT_INTERVAL_MS)
+    , last_video_ts_(-1)
+    , last_audio_ts_(-1) {
+}
+
+FLVSource::~FLVSource() {
+    close();
+}
+
+bool FLVSource::isPlaylist(const std::string& path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == "m3u" || ext == "m3u8" || ext == "txt" || ext == "lst";
+}
+
+bool FLVSource::loadPlaylist(const std::string& path, std::vector<std::string>& files, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Failed to open playlist: " + path;
+        return false;
+    }
+
+    size_t slash = path.rfind('/');
+    std::string dir = (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t start = line.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+        size_t end = line.find_last_not_of(" \t\r\n");
+        std::string entry = line.substr(start, end - start + 1);
+        files.push_back(entry[0] == '/' ? entry : dir + entry);
+    }
+
+    if (files.empty()) {
+        error = "Playlist is empty: " + path;
+        return false;
+    }
+    return true;
+}
+
+bool FLVSource::open(const std::vector<std::string>& files, const FLVSourceOptions& options) {
+    close();
+
+    if (files.empty()) {
+        last_error_ = "No FLV files to play";
+        return false;
+    }
+
+    files_ = files;
+    options_ = options;
+
+    if (options_.read_ahead_ms > 0 && !prefetcher_.start(options_.read_ahead_ms)) {
+        std::cerr << "Failed to start FLV prefetch thread, reading synchronously" << std::endl;
+    }
+
+    if (options_.resume) {
+        // 恢复位置无效时不跳到其他文件，由调用者决定是否从头推送
+        if (options_.resume_item >= files_.size()) {
+            last_error_ = "Resume item out of range";
+            return false;
+        }
+        item_index_ = options_.resume_item;
+        loops_completed_ = options_.resume_loops;
+        resuming_ = true;
+        bool started = startItem(item_index_);
+        resuming_ = false;
+        return started;
+    }
+
+    if (startItem(0)) {
+        return true;
+    }
+    // 第一个文件无法打开时尝试后续文件
+    return advanceItem();
+}
+
+void FLVSource::close() {
+    // 预读线程访问各文件的映射，必须先停止
+    prefetcher_.stop();
+    items_.clear();
+    resume_item_ = Item();
+    resuming_ = false;
+    resume_point_ = FLVSourcePosition();
+    files_.clear();
+    item_index_ = 0;
+    current_ = nullptr;
+    header_pos_ = 0;
+    item_has_media_ = false;
+    prefetched_ = false;
+    loops_completed_ = 0;
+    items_started_ = 0;
+    failed_in_row_ = 0;
+    started_ = false;
+    shift_ = 0;
+    last_output_ = -1;
+    last_interval_ = DEFAULT_INTERVAL_MS;
+    last_video_ts_ = -1;
+    last_audio_ts_ = -1;
+    video_header_.clear();
+    audio_header_.clear();
+}
+
+FLVSource::Item* FLVSource::prepareItem(const std::string& path) {
+    auto it = items_.find(path);
+    if (it != items_.end()) {
+        return &it->second;
+    }
+
+    Item item;
+    item.reader.reset(new FLVReader());
+    if (!item.reader->open(path)) {
+        last_error_ = item.reader->lastError();
+        return nullptr;
+    }
+
+    FLVTagView first;
+    if (!item.reader->next(first)) {
+        last_error_ = "FLV file has no tags: " + path;
+        return nullptr;
+    }
+    item.start_offset = first.offset;
+    item.start_timestamp = first.timestamp;
+    item.first_timestamp = first.timestamp;
+
+    if (options_.clip_start_ms > 0) {
+        // 通过索引直接定位，不需要从头读取文件
+        FLVIndex index;
+        bool indexed = options_.use_index ? index.loadOrBuild(path) : index.build(path);
+        FLVClipStart clip;
+        if (!indexed || !index.findClipStart(options_.clip_start_ms, clip)) {
+            last_error_ = "Failed to index FLV file: " + path;
+            return nullptr;
+        }
+        item.header_offsets = clip.header_offsets;
+        item.start_offset = clip.offset;
+        item.start_timestamp = clip.timestamp;
+        item.clipped = true;
+    }
+
+    return &(items_[path] = std::move(item));
+}
+
+FLVSource::Item* FLVSource::prepareResumeItem(const std::string& path) {
+    Item item;
+    item.reader.reset(new FLVReader());
+    if (!item.reader->open(path)) {
+        last_error_ = item.reader->lastError();
+        return nullptr;
+    }
+
+    FLVTagView first;
+    if (!item.reader->next(first)) {
+        last_error_ = "FLV file has no tags: " + path;
+        return nullptr;
+    }
+    item.first_timestamp = first.timestamp;
+
+    FLVIndex index;
+    bool indexed = options_.use_index ? index.loadOrBuild(path) : index.build(path);
+    FLVClipStart clip;
+    if (!indexed || !index.findResumeStart(options_.resume_offset, clip) ||
+        clip.timestamp != options_.resume_source_timestamp) {
+        last_error_ = "Resume position not found in " + path;
+        return nullptr;
+    }
+    item.header_offsets = clip.header_offsets;
+    item.start_offset = clip.offset;
+    item.start_timestamp = clip.timestamp;
+    item.clipped = true;
+
+    resume_item_ = std::move(item);
+    return &resume_item_;
+}
+
+bool FLVSource::startItem(size_t index) {
+    Item* item = resuming_ ? prepareResumeItem(files_[index]) : prepareItem(files_[index]);
+    if (!item) {
+        failed_in_row_++;
+        std::cerr << "Skipping FLV file: " << last_error_ << std::endl;
+        return false;
+    }
+
+    failed_in_row_ = 0;
+    items_started_++;
+    current_ = item;
+    header_pos_ = 0;
+    item_has_media_ = false;
+    prefetched_ = false;
+    last_video_ts_ = -1;
+    last_audio_ts_ = -1;
+
+    if (item->header_offsets.empty()) {
+        item->reader->seek(item->start_offset);
+    }
+
+    // 第一个文件保持原始时间戳(片段从0开始)，之后的文件接在已输出的最大时间戳之后
+    if (resuming_) {
+        shift_ = options_.resume_timestamp_base;
+        started_ = true;
+    } else if (!started_) {
+        shift_ = item->clipped ? -static_cast<int64_t>(item->start_timestamp) : 0;
+        started_ = true;
+    } else {
+        shift_ = last_output_ + last_interval_ - static_cast<int64_t>(item->start_timestamp);
+    }
+    return true;
+}
+
+bool FLVSource::advanceItem() {
+    while (true) {
+        size_t next = item_index_ + 1;
+        if (next >= files_.size()) {
+            loops_completed_++;
+            if (options_.loop_count != 0 && loops_completed_ >= options_.loop_count) {
+                current_ = nullptr;
+                return false;
+            }
+            next = 0;
+        }
+
+        item_index_ = next;
+        if (startItem(next)) {
+            return true;
+        }
+        if (failed_in_row_ >= files_.size()) {
+            // 整轮都无法打开，继续循环没有意义
+            current_ = nullptr;
+            return false;
+        }
+    }
+}
+
+void FLVSource::prefetchNext() {
+    prefetched_ = true;
+
+    size_t next = item_index_ + 1;
+    if (next >= files_.size()) {
+        bool last_loop = options_.loop_count != 0 && loops_completed_ + 1 >= options_.loop_count;
+        if (last_loop) {
+            return;
+        }
+        next = 0;
+    }
+
+    // 单文件循环时预读的是同一个文件的开头，顺序访问提示可能已经回收了这部分页
+    Item* item = prepareItem(files_[next]);
+    if (item) {
+        uint64_t offset = item->header_offsets.empty() ? item->start_offset : item->header_offsets.front();
+        item->reader->prefetch(offset, PREFETCH_BYTES);
+    }
+}
+
+bool FLVSource::acceptTag(FLVTagView& tag, uint8_t flags) {
+    if (flags & FLV_INDEX_METADATA) {
+        // 后续文件开头的onMetaData描述的是单个文件，不再发送
+        return items_started_ == 1 || item_has_media_;
+    }
+
+    if (flags & FLV_INDEX_SEQUENCE_HEADER) {
+        std::vector<uint8_t>& last = (tag.type == 9) ? video_header_ : audio_header_;
+        if (last.size() == tag.data_size && memcmp(last.data(), tag.data, tag.data_size) == 0) {
+            return false;
+        }
+        last.assign(tag.data, tag.data + tag.data_size);
+        return true;
+    }
+
+    if (tag.type == 8 || tag.type == 9) {
+        item_has_media_ = true;
+    }
+    return true;
+}
+
+bool FLVSource::next(FLVTagView& tag) {
+    while (current_) {
+        FLVReader& reader = *current_->reader;
+
+        if (header_pos_ < current_->header_offsets.size()) {
+            // 片段起点之前的元数据和序列头，时间戳与起始关键帧对齐
+            bool ok = reader.seek(current_->header_offsets[header_pos_++]) && reader.next(tag);
+            if (header_pos_ == current_->header_offsets.size()) {
+                reader.seek(current_->start_offset);
+            }
+            if (!ok) {
+                continue;
+            }
+            prefetcher_.update(&reader, tag);
+            tag.timestamp = current_->start_timestamp;
+        } else {
+            bool ok = reader.next(tag);
+            if (ok && options_.clip_end_ms > 0 &&
+                tag.timestamp >= current_->first_timestamp + options_.clip_end_ms) {
+                ok = false;
+            }
+            if (!ok) {
+                if (!advanceItem()) {
+                    return false;
+                }
+                continue;
+            }
+            prefetcher_.update(&reader, tag);
+        }
+
+        if (!prefetched_ && reader.fileSize() - reader.position() < PREFETCH_BYTES) {
+            prefetchNext();
+        }
+
+        uint8_t flags = FLVIndex::classifyTag(tag);
+        if (!acceptTag(tag, flags)) {
+            continue;
+        }
+
+        int64_t output = static_cast<int64_t>(tag.timestamp) + shift_;
+        if (output < 0) {
+            output = 0;
+        }
+
+        // 记录帧间隔，下一个文件按同样的间隔衔接
+        if (!(flags & FLV_INDEX_SEQUENCE_HEADER)) {
+            int64_t& last = (tag.type == 9) ? last_video_ts_ : last_audio_ts_;
+            bool use_interval = tag.type == 9 || (tag.type == 8 && last_video_ts_ < 0);
+            if ((tag.type == 8 || tag.type == 9) && last >= 0 && output > last && use_interval) {
+                last_interval_ = static_cast<uint32_t>(std::min<int64_t>(output - last, MAX_INTERVAL_MS));
+            }
+            if (tag.type == 8 || tag.type == 9) {
+                last = output;
+            }
+        }
+        last_output_ = std::max(last_output_, output);
+
+        // 关键帧之前的标签都已输出，可以从这里恢复；没有视频时任意音频标签都可以
+        if ((flags & FLV_INDEX_KEYFRAME) ||
+            (tag.type == 8 && !(flags & FLV_INDEX_SEQUENCE_HEADER) && last_video_ts_ < 0)) {
+            resume_point_.valid = true;
+            resume_point_.item = item_index_;
+            resume_point_.loops = loops_completed_;
+            resume_point_.offset = tag.offset;
+            resume_point_.source_timestamp = tag.timestamp;
+            resume_point_.timestamp_base = shift_;
+        }
+
+        tag.timestamp = static_cast<uint32_t>(output);   // 超过32位时按RTMP时间戳回绕
+        return true;
+    }
+
+    return false;
+}
+
+size_t FLVSource::currentItem() const {
+    return item_index_;
+}
+
+const std::vector<std::string>& FLVSource::files() const {
+    return files_;
+}
+
+const FLVSourcePosition& FLVSource::resumePoint() const {
+    return resume_point_;
+}
+
+uint32_t FLVSource::loopsCompleted() const {
+    return loops_completed_;
+}
+
+uint64_t FLVSource::lowBufferEvents() const {
+    return prefetcher_.lowBufferEvents();
+}
+
+uint32_t FLVSource::bufferedMs() const {
+    return prefetcher_.bufferedMs();
+}
+
+const std::string& FLVSource::lastError() const {
+    return last_error_;
+}
@@ -0,0 +1,124 @@
+#ifndef FLV_SOURCE_H
+#define FLV_SOURCE_H
+
+#include "flv_reader.h"
+#include "flv_prefetcher.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+struct FLVSourceOptions {
+    uint32_t clip_start_ms = 0;     // 每个文件从该时间点之前最近的关键帧开始
+    uint32_t clip_end_ms = 0;       // 0表示到文件结尾
+    bool use_index = true;          // 定位时使用并生成索引旁路文件
+    uint32_t loop_count = 1;        // 整个列表的播放次数，0表示无限循环
+    uint32_t read_ahead_ms = 0;     // 预读线程提前读入的媒体时长，0表示不启用
+
+    // 从检查点恢复：第一个播放的是files[resume_item](已完成resume_loops轮)，从resume_offset处的
+    // 标签开始(先补发其前面的元数据和序列头)，输出时间戳 = 原始时间戳 + resume_timestamp_base
+    bool resume = false;
+    size_t resume_item = 0;
+    uint32_t resume_loops = 0;
+    uint64_t resume_offset = 0;
+    uint32_t resume_source_timestamp = 0;   // 该标签的原始时间戳，用于校验文件未变化
+    int64_t resume_timestamp_base = 0;
+};
+
+// 可以从中恢复推送的位置：最近输出的视频关键帧(纯音频时为音频标签)
+struct FLVSourcePosition {
+    bool valid = false;
+    size_t item = 0;                // 在文件列表中的位置
+    uint32_t loops = 0;             // 此前已完成的轮数
+    uint64_t offset = 0;            // 标签头在文件中的偏移
+    uint32_t source_timestamp = 0;  // 文件中的原始时间戳
+    int64_t timestamp_base = 0;     // 输出时间戳 - 原始时间戳
+};
+
+// 连续的FLV标签源：按顺序(可循环)播放一个或多个FLV文件，输出一条时间戳单调递增的标签流。
+// - 每个文件的时间戳平移到上一个文件末尾之后，服务器看到的是一条连续的流
+// - 序列头与上次发送的相同时跳过，编码参数变化时才重新发送；后续文件开头的onMetaData跳过
+// - 当前文件剩余数据不多时提前打开并预读下一个文件
+// - 启用read_ahead_ms时由FLVPrefetcher在独立线程上提前读入当前文件的后续数据
+// - 可以从检查点记录的位置恢复，时间戳接续中断前的时间轴
+// 打开过的文件映射保留到close()，已输出的标签视图在此之前一直有效。
+class FLVSource {
+public:
+    FLVSource();
+    ~FLVSource();
+
+    bool open(const std::vector<std::string>& files, const FLVSourceOptions& options);
+    void close();
+
+    // 读取下一个标签，时间戳已经过平移；全部播放完毕或没有可读文件时返回false
+    bool next(FLVTagView& tag);
+
+    size_t currentItem() const;
+    const std::vector<std::string>& files() const;
+    // 最近的恢复位置，之前的标签都已由next()输出
+    const FLVSourcePosition& resumePoint() const;
+    uint32_t loopsCompleted() const;
+    uint64_t lowBufferEvents() const;
+    uint32_t bufferedMs() const;
+    const std::string& lastError() const;
+
+    // 播放列表文件：每行一个FLV路径，#开头为注释，相对路径相对于列表文件所在目录
+    static bool isPlaylist(const std::string& path);
+    static bool loadPlaylist(const std::string& path, std::vector<std::string>& files, std::string& error);
+
+private:
+    FLVSource(const FLVSource&);
+    FLVSource& operator=(const FLVSource&);
+
+    // 打开文件并定位到片段起点，同一文件只映射一次
+    struct Item {
+        std::unique_ptr<FLVReader> reader;
+        std::vector<uint64_t> header_offsets;   // 片段起点前需要补发的元数据和序列头
+        uint64_t start_offset = 0;
+        uint32_t start_timestamp = 0;           // 本文件输出的第一个时间戳(原始值)
+        uint32_t first_timestamp = 0;           // 文件首个标签时间戳，片段结束时间的基准
+        bool clipped = false;
+    };
+
+    Item* prepareItem(const std::string& path);
+    Item* prepareResumeItem(const std::string& path);
+    bool startItem(size_t index);
+    bool advanceItem();
+    void prefetchNext();
+    bool acceptTag(FLVTagView& tag, uint8_t flags);
+
+    std::vector<std::string> files_;
+    FLVSourceOptions options_;
+    std::map<std::string, Item> items_;
+    Item resume_item_;          // 恢复的第一个文件单独映射，不影响之后循环时的起点
+    bool resuming_;
+
+    size_t item_index_;
+    Item* current_;
+    size_t header_pos_;
+    bool item_has_media_;       // 当前文件是否已输出过音视频标签
+    bool prefetched_;
+    uint32_t loops_completed_;
+    uint32_t items_started_;    // 已开始播放的文件数(含循环)
+    size_t failed_in_row_;      // 连续打开失败的文件数，整轮都失败时结束
+
+    // 时间轴：输出时间戳 = 原始时间戳 + shift_
+    bool started_;
+    int64_t shift_;
+    int64_t last_output_;               // 已输出的最大时间戳
+    uint32_t last_interval_;            // 最近的视频(无视频时音频)帧间隔，文件衔接时使用
+    int64_t last_video_ts_;
+    int64_t last_audio_ts_;
+
+    FLVSourcePosition resume_point_;
+
+    std::vector<uint8_t> video_header_;
+    std::vector<uint8_t> audio_header_;
+
+    FLVPrefetcher prefetcher_;
+
+    std::string last_error_;
+};
+
+#endif // FLV_SOURCE_H
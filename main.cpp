@@ -1,9 +1,14 @@
 #include "rtmp_client.h"
 #include "rtmp_logger.h"
 #include "config_parser.h"
+#include "rtmp_stream_manager.h"
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cstring>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -27,11 +32,75 @@ namespace fs {
     }
 }
 
+static std::atomic<bool> g_stop_requested(false);
+
+static void handleStopSignal(int) {
+    g_stop_requested = true;
+}
+
+// 清单模式：一个进程运行清单中的所有推流，直到收到SIGINT/SIGTERM
+// （或exit_when_idle开启且所有推流都已结束）
+static int runManifest(const std::string& manifest_file) {
+    fs::create_directories("logs");
+
+    RTMPClient log_client;
+    ConfigParser manifest;
+    if (!fs::exists(manifest_file) || !manifest.loadConfig(manifest_file)) {
+        std::cerr << "Failed to load manifest file: " << manifest_file << std::endl;
+        return 1;
+    }
+    log_client.setLogLevel(manifest.getString("logging", "log_level", "info"));
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handleStopSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    std::vector<StreamStatus> final_status;
+    {
+        RTMPStreamManager manager;
+        if (!manager.start(manifest_file)) {
+            RTMP_LOG_ERROR(log_client, "多路推流启动失败: " + manifest_file);
+            log_client.flushLogs();
+            return 1;
+        }
+
+        while (!g_stop_requested && manager.isActive()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        manager.stop();
+        final_status = manager.getStatus();
+    }
+
+    // 显示每路推流的最终统计
+    int failed = 0;
+    for (const auto& status : final_status) {
+        if (status.state == STREAM_FAILED) {
+            failed++;
+        }
+        RTMP_LOG_INFO(log_client, "STATS[" + status.name + "]: State=" +
+                      RTMPStreamManager::stateName(status.state) +
+                      ", Restarts=" + std::to_string(status.restarts) + ", " +
+                      RTMPStreamManager::formatStatistics(status.statistics));
+    }
+
+    log_client.flushLogs();
+    log_client.shutdownLogger();
+    return failed > 0 ? 1 : 0;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc == 3 && std::string(argv[1]) == "--manifest") {
+        return runManifest(argv[2]);
+    }
+
     if (argc < 3 || argc > 4) {
         std::cerr << "Usage: " << argv[0] << " <rtmp_url> <flv_file> [config_file]" << std::endl;
+        std::cerr << "       " << argv[0] << " --manifest <manifest_file>" << std::endl;
         std::cerr << "Example: " << argv[0] << " rtmp://localhost:1935/live/stream test.flv" << std::endl;
         std::cerr << "         " << argv[0] << " rtmp://localhost:1935/live/stream test.flv rtmp_client.conf" << std::endl;
+        std::cerr << "         " << argv[0] << " --manifest streams.conf" << std::endl;
         return 1;
     }
     
@@ -61,16 +130,7 @@ int main(int argc, char* argv[]) {
     client.setLogLevel(log_level);
     
     // 从配置文件配置客户端参数
-    RTMPConfig rtmp_config;
-    rtmp_config.connect_timeout_ms = config.getInt("connection", "connect_timeout_ms", 10000);
-    rtmp_config.read_timeout_ms = config.getInt("connection", "read_timeout_ms", 3000);
-    rtmp_config.write_timeout_ms = config.getInt("connection", "write_timeout_ms", 3000);
-    rtmp_config.max_retry_count = config.getInt("connection", "max_retry_count", 3);
-    rtmp_config.retry_interval_ms = config.getInt("connection", "retry_interval_ms", 1000);
-    rtmp_config.enable_heartbeat = config.getBool("rtmp", "enable_heartbeat", true);
-    rtmp_config.heartbeat_interval_ms = config.getInt("rtmp", "heartbeat_interval_ms", 30000);
-    rtmp_config.enable_statistics = config.getBool("statistics", "enable_statistics", true);
-    rtmp_config.max_queue_size = config.getInt("performance", "max_queue_size", 1000);
+    RTMPConfig rtmp_config = RTMPStreamManager::buildConfig(config);
     
     client.setConfig(rtmp_config);
     
@@ -130,16 +190,7 @@ int main(int argc, char* argv[]) {
     // 显示最终统计
     // 获取并打印统计信息
     auto stats = client.getStatistics();
-    auto runtime = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::steady_clock::now() - stats.start_time);
-    
-    RTMP_LOG_INFO(client, "STATS: Runtime=" + std::to_string(runtime.count()) + "s" +
-                  ", Sent=" + std::to_string(stats.bytes_sent / 1024) + "KB" +
-                  ", Recv=" + std::to_string(stats.bytes_received / 1024) + "KB" +
-                  ", AudioFrames=" + std::to_string(stats.audio_frames) +
-                  ", VideoFrames=" + std::to_string(stats.video_frames) +
-                  ", Dropped=" + std::to_string(stats.dropped_frames) +
-                  ", AvgBitrate=" + std::to_string(stats.avg_bitrate / 1000) + "kbps");
+    RTMP_LOG_INFO(client, "STATS: " + RTMPStreamManager::formatStatistics(stats));
     RTMP_LOG_INFO(client, "推流任务成功完成");
     
     // 刷新并关闭日志
@@ -0,0 +1,228 @@
+#include "rtmp_checkpoint.h"
+#include "rtmp_client.h"
+#include "rtmp_logger.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// 检查点文件格式版本，格式变化时旧文件被忽略
+static const int CHECKPOINT_VERSION = 2;
+
+static bool statFile(const std::string& file, uint64_t& size, int64_t& mtime_sec, uint32_t& mtime_nsec) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_sec = static_cast<int64_t>(st.st_mtim.tv_sec);
+    mtime_nsec = static_cast<uint32_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+RTMPCheckpointWriter::RTMPCheckpointWriter()
+    : interval_ms_(5000)
+    , log_client_(nullptr)
+    , running_(false)
+    , dirty_(false)
+    , writes_(0) {
+}
+
+RTMPCheckpointWriter::~RTMPCheckpointWriter() {
+    stop(false);
+}
+
+bool RTMPCheckpointWriter::start(const std::string& path, uint32_t interval_ms,
+                                 const std::vector<std::string>& files, RTMPClient& log_client) {
+    stop(false);
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    log_client_ = &log_client;
+    interval_ms_ = interval_ms > 0 ? interval_ms : 1;
+    files_ = files;
+    position_ = FLVSourcePosition();
+    dirty_ = false;
+    running_ = true;
+    try {
+        thread_ = std::thread(&RTMPCheckpointWriter::threadFunc, this);
+    } catch (const std::system_error&) {
+        running_ = false;
+        return false;
+    }
+    return true;
+}
+
+void RTMPCheckpointWriter::update(const FLVSourcePosition& position) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (position.offset == position_.offset && position.item == position_.item &&
+        position.loops == position_.loops && position.valid == position_.valid) {
+        return;
+    }
+    position_ = position;
+    dirty_ = true;
+}
+
+void RTMPCheckpointWriter::stop(bool completed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (completed) {
+        // 任务已完成，下次运行从头开始
+        if (unlink(path_.c_str()) != 0 && errno != ENOENT) {
+            RTMP_LOG_WARN(*log_client_, "Failed to remove checkpoint " + path_ + ": " + strerror(errno));
+        }
+    } else if (dirty_) {
+        writeLocked(lock);
+    }
+}
+
+uint64_t RTMPCheckpointWriter::writes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writes_;
+}
+
+void RTMPCheckpointWriter::threadFunc() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        wakeup_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [this] { return !running_; });
+        if (running_ && dirty_) {
+            writeLocked(lock);
+        }
+    }
+}
+
+void RTMPCheckpointWriter::writeLocked(std::unique_lock<std::mutex>& lock) {
+    RTMPCheckpointState state;
+    state.files = files_;
+    state.position = position_;
+    std::string path = path_;
+    dirty_ = false;
+    if (!state.position.valid) {
+        return;
+    }
+
+    // 文件IO在锁外进行，推流线程的update()不会等待磁盘
+    lock.unlock();
+    statFile(state.files[state.position.item], state.file_size, state.file_mtime_sec,
+             state.file_mtime_nsec);
+    state.wall_clock_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string error;
+    bool saved = save(path, state, error);
+    if (!saved) {
+        RTMP_LOG_WARN(*log_client_, error);
+    }
+    lock.lock();
+    if (saved) {
+        writes_++;
+    }
+}
+
+bool RTMPCheckpointWriter::save(const std::string& path, const RTMPCheckpointState& state, std::string& error) {
+    std::ostringstream out;
+    out << "version=" << CHECKPOINT_VERSION << "\n";
+    for (const auto& file : state.files) {
+        out << "file=" << file << "\n";
+    }
+    out << "item=" << state.position.item << "\n"
+        << "loops=" << state.position.loops << "\n"
+        << "file_size=" << state.file_size << "\n"
+        << "file_mtime=" << state.file_mtime_sec << "\n"
+        << "file_mtime_nsec=" << state.file_mtime_nsec << "\n"
+        << "offset=" << state.position.offset << "\n"
+        << "source_timestamp=" << state.position.source_timestamp << "\n"
+        << "timestamp_base=" << state.position.timestamp_base << "\n"
+        << "wall_clock_ms=" << state.wall_clock_ms << "\n";
+    std::string data = out.str();
+
+    // 写临时文件并落盘后重命名，读者只会看到完整的检查点
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "Failed to create checkpoint " + tmp + ": " + strerror(errno);
+        return false;
+    }
+    bool ok = write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()) && fdatasync(fd) == 0;
+    int saved_errno = errno;
+    close(fd);
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        error = "Failed to write checkpoint " + path + ": " + strerror(ok ? errno : saved_errno);
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool RTMPCheckpointWriter::load(const std::string& path, RTMPCheckpointState& state, std::string& error) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = errno == ENOENT ? "" : "Failed to open checkpoint " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    state = RTMPCheckpointState();
+    int version = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, eq);
+        std::string value = line.substr(eq + 1);
+        std::istringstream number(value);
+        if (key == "version") {
+            number >> version;
+        } else if (key == "file") {
+            state.files.push_back(value);
+        } else if (key == "item") {
+            number >> state.position.item;
+        } else if (key == "loops") {
+            number >> state.position.loops;
+        } else if (key == "file_size") {
+            number >> state.file_size;
+        } else if (key == "file_mtime") {
+            number >> state.file_mtime_sec;
+        } else if (key == "file_mtime_nsec") {
+            number >> state.file_mtime_nsec;
+        } else if (key == "offset") {
+            number >> state.position.offset;
+        } else if (key == "source_timestamp") {
+            number >> state.position.source_timestamp;
+        } else if (key == "timestamp_base") {
+            number >> state.position.timestamp_base;
+        } else if (key == "wall_clock_ms") {
+            number >> state.wall_clock_ms;
+        }
+    }
+
+    if (version != CHECKPOINT_VERSION || state.files.empty() || state.position.item >= state.files.size()) {
+        error = "Invalid checkpoint: " + path;
+        return false;
+    }
+    state.position.valid = true;
+    return true;
+}
+
+bool RTMPCheckpointWriter::matchesFile(const RTMPCheckpointState& state, const std::string& file) {
+    uint64_t size = 0;
+    int64_t mtime_sec = 0;
+    uint32_t mtime_nsec = 0;
+    return statFile(file, size, mtime_sec, mtime_nsec) && size == state.file_size &&
+           mtime_sec == state.file_mtime_sec && mtime_nsec == state.file_mtime_nsec;
+}
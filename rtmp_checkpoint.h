@@ -0,0 +1,71 @@
+#ifndef RTMP_CHECKPOINT_H
+#define RTMP_CHECKPOINT_H
+
+#include "flv_source.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <cstdint>
+
+class RTMPClient;
+
+// 推送任务的检查点：任务的文件列表、恢复位置所在文件的身份(大小和修改时间)、
+// 最近关键帧的偏移和时间戳基准，以及写入时的墙钟时刻
+struct RTMPCheckpointState {
+    std::vector<std::string> files;
+    FLVSourcePosition position;
+    uint64_t file_size = 0;
+    int64_t file_mtime_sec = 0;
+    uint32_t file_mtime_nsec = 0;   // 同一秒内原地改写的文件靠纳秒区分
+    int64_t wall_clock_ms = 0;      // 写入时刻(Unix毫秒)
+};
+
+// 检查点写入线程：推流线程只复制恢复位置，文件写入(临时文件、fsync、rename)在独立线程上
+// 每隔interval_ms进行一次，位置没有变化时不写。重命名是原子的，进程随时被杀死
+// 留下的都是完整的旧检查点或新检查点。
+class RTMPCheckpointWriter {
+public:
+    RTMPCheckpointWriter();
+    ~RTMPCheckpointWriter();
+
+    // 写入失败通过log_client的日志输出，log_client在stop()之前必须有效
+    bool start(const std::string& path, uint32_t interval_ms, const std::vector<std::string>& files,
+               RTMPClient& log_client);
+    // 不做IO，只在位置变化时加锁复制
+    void update(const FLVSourcePosition& position);
+    // 任务完成时删除检查点，否则写入最后的位置
+    void stop(bool completed);
+
+    uint64_t writes() const;
+
+    static bool save(const std::string& path, const RTMPCheckpointState& state, std::string& error);
+    // 检查点文件不存在时返回false，error为空
+    static bool load(const std::string& path, RTMPCheckpointState& state, std::string& error);
+    // 文件的大小和修改时间(精确到纳秒)是否与检查点记录的一致
+    static bool matchesFile(const RTMPCheckpointState& state, const std::string& file);
+
+private:
+    RTMPCheckpointWriter(const RTMPCheckpointWriter&);
+    RTMPCheckpointWriter& operator=(const RTMPCheckpointWriter&);
+
+    void threadFunc();
+    void writeLocked(std::unique_lock<std::mutex>& lock);
+
+    std::string path_;
+    uint32_t interval_ms_;
+    std::vector<std::string> files_;
+    RTMPClient* log_client_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::thread thread_;
+    bool running_;
+    bool dirty_;
+    FLVSourcePosition position_;
+    uint64_t writes_;
+};
+
+#endif // RTMP_CHECKPOINT_H
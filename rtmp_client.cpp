@@ -1,12 +1,17 @@
 #include "rtmp_client.h"
 #include "rtmp_logger.h"
+#include "flv_index.h"
 #include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <climits>
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <thread>
@@ -14,20 +19,90 @@
 #include <random>
 #include <cmath>
 
+// 每次发送最多占用两个SQE(sendmsg和链接超时)
+static const unsigned IO_URING_ENTRIES = 8;
+
+// 写线程一次最多取出并合并发送的帧数
+static const size_t WRITER_BATCH_MAX = 32;
+
+// 每次接收至少预留的缓冲区空间
+static const size_t INBOUND_READ_SIZE = 16384;
+
+// 控制消息读取线程检查退出标志的间隔
+static const int CONTROL_READ_POLL_MS = 100;
+
+// 断开时发送FIN后等待服务器关闭的最长时间
+static const int CLOSE_DRAIN_TIMEOUT_MS = 1000;
+
 RTMPClient::RTMPClient() 
     : socket_fd_(-1)
     , server_port_(1935)
-    , chunk_size_(128)
+    , in_chunk_size_(128)
+    , out_chunk_size_(128)
     , bytes_read_(0)
     , bytes_read_last_ack_(0)
-    , window_ack_size_(2500000) {
+    , window_ack_size_(2500000)
+    , connect_succeeded_(false)
+    , stream_created_(false)
+    , publish_started_(false)
+    , stream_id_(1)
+    , pipelined_stream_id_(0)
+    , inbound_offset_(0)
+    , inbound_end_(0)
+    , async_mode_(false)
+    , async_phase_(ASYNC_IDLE)
+    , async_output_offset_(0)
+    , async_tag_pending_(false)
+    , async_s2_remaining_(0)
+    , connection_state_(STATE_DISCONNECTED)
+    , pacing_total_late_us_(0)
+    , heartbeat_running_(false)
+    , heartbeat_paused_(false)
+    , control_reader_running_(false)
+    , control_wake_fd_(-1)
+    , writer_running_(false)
+    , writer_failed_(false)
+    , writer_draining_(false)
+    , drop_until_keyframe_(false)
+    , flush_send_calls_(0)
+    , congestion_sampling_(false)
+    , congestion_dropping_(false)
+    , socket_cork_(false)
+    , standby_running_(false)
+    , standby_taken_(false)
+    , standby_heartbeat_busy_(false)
+    , reconnect_backoff_ms_(0)
+    , reconnect_attempts_used_(0) {
+    resetChunkStreams();
+    statistics_.start_time = std::chrono::steady_clock::now();
+    statistics_.last_update = statistics_.start_time;
 }
 
 RTMPClient::~RTMPClient() {
     disconnect();
+    if (control_wake_fd_ >= 0) {
+        close(control_wake_fd_);
+    }
 }
 
 bool RTMPClient::connect(const std::string& url) {
+    if (!establishSession(url, STARTUP_PUBLISH)) {
+        return false;
+    }
+    
+    setState(STATE_PUBLISHING);
+    recordStartup();
+    RTMP_LOG_DEBUG(*this, "RTMP连接和初始化完成，进入推流状态");
+    beginPublishing();
+    
+    // 推流期间在后台保持到备用服务器的连接
+    if (!config_.backup_url.empty()) {
+        startStandby(config_.backup_url);
+    }
+    return true;
+}
+
+bool RTMPClient::establishSession(const std::string& url, StartupStage stage) {
     RTMP_LOG_DEBUG(*this, "开始连接到RTMP服务器: " + url);
     
     // 解析URL
@@ -36,141 +111,167 @@ bool RTMPClient::connect(const std::string& url) {
         RTMP_LOG_ERROR(*this, "URL解析失败");
         return false;
     }
+    session_url_ = url;
     RTMP_LOG_DEBUG(*this, "URL解析成功 - Host: " + server_host_ + ", Port: " + std::to_string(server_port_) + ", App: " + app_name_ + ", Stream: " + stream_key_);
     
-    // 创建socket
-    RTMP_LOG_DEBUG(*this, "创建TCP socket");
-    socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd_ < 0) {
-        setError("Failed to create socket: " + std::string(strerror(errno)));
-        RTMP_LOG_ERROR(*this, "Socket创建失败: " + std::string(strerror(errno)));
-        return false;
-    }
-    RTMP_LOG_DEBUG(*this, "Socket创建成功, fd=" + std::to_string(socket_fd_));
+    // 上一个连接的控制消息读取线程不能再访问socket和入站状态
+    stopControlReader();
     
-    // 设置socket为非阻塞模式
-    RTMP_LOG_DEBUG(*this, "设置socket为非阻塞模式");
-    int flags = fcntl(socket_fd_, F_GETFL, 0);
-    fcntl(socket_fd_, F_SETFL, flags | O_NONBLOCK);
-    
-    // 连接到服务器
-    RTMP_LOG_DEBUG(*this, "准备连接到服务器地址");
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(server_port_);
-    
-    if (inet_pton(AF_INET, server_host_.c_str(), &server_addr.sin_addr) <= 0) {
-        setError("Invalid server address: " + server_host_);
-        RTMP_LOG_ERROR(*this, "无效的服务器地址: " + server_host_);
-        close(socket_fd_);
-        socket_fd_ = -1;
+    // 解析服务器地址，主机名在共享解析器的后台线程上查询，结果按TTL缓存
+    RTMP_LOG_DEBUG(*this, "解析服务器地址: " + server_host_);
+    connect_started_ = std::chrono::steady_clock::now();
+    std::shared_ptr<RTMPResolveRequest> request = RTMPResolver::instance().resolve(server_host_, server_port_, resolveOptions());
+    if (!request->wait(config_.connect_timeout_ms)) {
+        setError("DNS resolution timeout: " + server_host_);
+        RTMP_LOG_ERROR(*this, "解析服务器地址超时: " + server_host_);
         return false;
     }
-    RTMP_LOG_DEBUG(*this, "服务器地址解析成功");
-    
-    RTMP_LOG_DEBUG(*this, "发起TCP连接");
-    int result = ::connect(socket_fd_, (struct sockaddr*)&server_addr, sizeof(server_addr));
-    if (result < 0 && errno != EINPROGRESS) {
-        setError("Failed to connect: " + std::string(strerror(errno)));
-        RTMP_LOG_ERROR(*this, "TCP连接失败: " + std::string(strerror(errno)));
-        close(socket_fd_);
-        socket_fd_ = -1;
+    if (!request->succeeded()) {
+        setError(request->error());
+        RTMP_LOG_ERROR(*this, "解析服务器地址失败: " + request->error());
         return false;
     }
-    RTMP_LOG_DEBUG(*this, "TCP连接已发起，等待完成");
-    
-    // 等待连接完成
-    RTMP_LOG_DEBUG(*this, "使用select等待连接完成，超时: " + std::to_string(config_.connect_timeout_ms) + "ms");
-    fd_set write_fds;
-    FD_ZERO(&write_fds);
-    FD_SET(socket_fd_, &write_fds);
-    
-    struct timeval timeout;
-    timeout.tv_sec = config_.connect_timeout_ms / 1000;
-    timeout.tv_usec = (config_.connect_timeout_ms % 1000) * 1000;
     
-    result = select(socket_fd_ + 1, nullptr, &write_fds, nullptr, &timeout);
-    if (result <= 0) {
-        setError("Connection timeout or error");
-        RTMP_LOG_ERROR(*this, "连接超时或错误, select result=" + std::to_string(result));
-        close(socket_fd_);
-        socket_fd_ = -1;
+    // 对解析出的地址并行连接，第一个建立的连接获胜
+    if (!startConnectRace(*request)) {
         return false;
     }
-    RTMP_LOG_DEBUG(*this, "select返回成功，检查连接状态");
-    
-    // 检查连接是否成功
-    int error = 0;
-    socklen_t len = sizeof(error);
-    if (getsockopt(socket_fd_, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
-        setError("Connection failed: " + std::string(strerror(error)));
-        RTMP_LOG_ERROR(*this, "连接失败: " + std::string(strerror(error)));
-        close(socket_fd_);
-        socket_fd_ = -1;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - connect_started_).count();
+    int remaining_ms = std::max<int>(1, static_cast<int>(config_.connect_timeout_ms) - static_cast<int>(elapsed));
+    RTMP_LOG_DEBUG(*this, "等待TCP连接完成，超时: " + std::to_string(remaining_ms) + "ms");
+    if (!finishConnectRace(connect_race_.run(remaining_ms))) {
         return false;
     }
-    RTMP_LOG_DEBUG(*this, "TCP连接建立成功");
     
     // 设置socket为阻塞模式
     RTMP_LOG_DEBUG(*this, "设置socket为阻塞模式");
-    flags = fcntl(socket_fd_, F_GETFL, 0);
+    int flags = fcntl(socket_fd_, F_GETFL, 0);
     fcntl(socket_fd_, F_SETFL, flags & ~O_NONBLOCK);
     
     // 设置socket超时
     RTMP_LOG_DEBUG(*this, "设置socket超时: " + std::to_string(config_.read_timeout_ms) + "ms");
     setSocketTimeout(config_.read_timeout_ms);
     
-    setState(STATE_CONNECTED);
-    
-    // 执行RTMP握手
-    RTMP_LOG_DEBUG(*this, "开始RTMP握手");
-    if (!handshake()) {
-        RTMP_LOG_ERROR(*this, "RTMP握手失败");
-        close(socket_fd_);
-        socket_fd_ = -1;
-        return false;
-    }
-    RTMP_LOG_DEBUG(*this, "RTMP握手完成");
-    
-    // 发送connect命令
-    RTMP_LOG_DEBUG(*this, "发送RTMP connect命令");
-    if (!sendConnect()) {
-        RTMP_LOG_ERROR(*this, "发送connect命令失败");
-        close(socket_fd_);
-        socket_fd_ = -1;
-        return false;
+    // 新连接的块大小从协议默认值开始
+    in_chunk_size_ = 128;
+    out_chunk_size_ = 128;
+    resetChunkStreams();
+    resetInboundState();
+    connect_succeeded_ = false;
+    stream_created_ = false;
+    publish_started_ = false;
+    stream_id_ = 1;
+    pipelined_stream_id_ = 0;
+    
+    if (config_.pipelined_startup) {
+        // 流水线启动：握手和全部命令约两个往返完成
+        RTMP_LOG_DEBUG(*this, "开始流水线握手和启动命令");
+        if (!pipelinedStartup(stage)) {
+            RTMP_LOG_ERROR(*this, "流水线启动失败: " + getLastError());
+            close(socket_fd_);
+            socket_fd_ = -1;
+            return false;
+        }
+        RTMP_LOG_DEBUG(*this, "流水线启动完成");
+    } else {
+        // 执行RTMP握手
+        RTMP_LOG_DEBUG(*this, "开始RTMP握手");
+        if (!handshake()) {
+            RTMP_LOG_ERROR(*this, "RTMP握手失败");
+            close(socket_fd_);
+            socket_fd_ = -1;
+            return false;
+        }
+        RTMP_LOG_DEBUG(*this, "RTMP握手完成");
+        
+        // 通告发送方向的块大小
+        if (config_.chunk_size != out_chunk_size_) {
+            RTMP_LOG_DEBUG(*this, "发送Set Chunk Size: " + std::to_string(config_.chunk_size));
+            if (!sendSetChunkSize(config_.chunk_size)) {
+                RTMP_LOG_ERROR(*this, "发送Set Chunk Size失败");
+                close(socket_fd_);
+                socket_fd_ = -1;
+                return false;
+            }
+        }
+        
+        // 发送connect命令
+        RTMP_LOG_DEBUG(*this, "发送RTMP connect命令");
+        if (!sendConnect()) {
+            RTMP_LOG_ERROR(*this, "发送connect命令失败");
+            close(socket_fd_);
+            socket_fd_ = -1;
+            return false;
+        }
+        RTMP_LOG_DEBUG(*this, "connect命令发送成功");
+        if (stage == STARTUP_CONNECT) {
+            setState(STATE_CONNECTED);
+            return true;
+        }
+        
+        // 发送createStream命令
+        RTMP_LOG_DEBUG(*this, "发送RTMP createStream命令");
+        if (!sendCreateStream()) {
+            RTMP_LOG_ERROR(*this, "发送createStream命令失败");
+            close(socket_fd_);
+            socket_fd_ = -1;
+            return false;
+        }
+        RTMP_LOG_DEBUG(*this, "createStream命令发送成功");
+        if (stage == STARTUP_CREATE_STREAM) {
+            setState(STATE_CONNECTED);
+            return true;
+        }
+        
+        // 发送publish命令
+        RTMP_LOG_DEBUG(*this, "发送RTMP publish命令");
+        if (!sendPublish()) {
+            RTMP_LOG_ERROR(*this, "发送publish命令失败");
+            close(socket_fd_);
+            socket_fd_ = -1;
+            return false;
+        }
+        RTMP_LOG_DEBUG(*this, "publish命令发送成功");
     }
-    RTMP_LOG_DEBUG(*this, "connect命令发送成功");
     
-    // 发送createStream命令
-    RTMP_LOG_DEBUG(*this, "发送RTMP createStream命令");
-    if (!sendCreateStream()) {
-        RTMP_LOG_ERROR(*this, "发送createStream命令失败");
-        close(socket_fd_);
-        socket_fd_ = -1;
-        return false;
+    // 握手和启动命令完成后才进入已连接状态，之前心跳等线程不会向新socket写入
+    setState(STATE_CONNECTED);
+    return true;
+}
+
+void RTMPClient::beginPublishing() {
+    // 握手和命令交互走普通路径，推流数据和之后的控制消息通过io_uring发送。
+    // 发布开始后心跳等线程可能已经在发送，建立ring需要持有send_mutex_
+    if (config_.enable_io_uring) {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (io_uring_.init(IO_URING_ENTRIES)) {
+            if (!io_uring_.registerFile(socket_fd_)) {
+                RTMP_LOG_WARN(*this, io_uring_.lastError());
+            }
+            RTMP_LOG_INFO(*this, "发送后端: io_uring");
+        } else {
+            RTMP_LOG_WARN(*this, "io_uring不可用，回退到sendmsg: " + io_uring_.lastError());
+        }
     }
-    RTMP_LOG_DEBUG(*this, "createStream命令发送成功");
     
-    // 发送publish命令
-    RTMP_LOG_DEBUG(*this, "发送RTMP publish命令");
-    if (!sendPublish()) {
-        RTMP_LOG_ERROR(*this, "发送publish命令失败");
-        close(socket_fd_);
-        socket_fd_ = -1;
-        return false;
+    // 零拷贝只用于推流数据，完成通知由控制消息读取线程和发送路径读取
+    zerocopy_.reset();
+    if (config_.enable_zerocopy) {
+        std::string error;
+        if (zerocopy_.enable(socket_fd_, error)) {
+            RTMP_LOG_INFO_F(*this, "零拷贝发送: 不小于%u字节的音视频消息使用MSG_ZEROCOPY", config_.zerocopy_threshold);
+        } else {
+            RTMP_LOG_WARN(*this, error + "，使用普通发送");
+        }
     }
-    RTMP_LOG_DEBUG(*this, "publish命令发送成功");
     
-    setState(STATE_PUBLISHING);
-    RTMP_LOG_DEBUG(*this, "RTMP连接和初始化完成，进入推流状态");
-    return true;
+    resetCongestionMonitor();
+    startControlReader();
 }
 
-bool RTMPClient::handshake() {
-    // RTMP握手过程
-    std::vector<uint8_t> c0c1(1537);
+void RTMPClient::generateC0C1(std::vector<uint8_t>& c0c1) {
+    c0c1.resize(1537);
     c0c1[0] = 0x03; // RTMP版本
     
     // 生成随机数据
@@ -181,6 +282,12 @@ bool RTMPClient::handshake() {
     for (int i = 1; i < 1537; i++) {
         c0c1[i] = dis(gen);
     }
+}
+
+bool RTMPClient::handshake() {
+    // RTMP握手过程
+    std::vector<uint8_t> c0c1;
+    generateC0C1(c0c1);
     
     // 发送C0+C1
     if (send(socket_fd_, c0c1.data(), c0c1.size(), 0) != c0c1.size()) {
@@ -210,7 +317,116 @@ bool RTMPClient::handshake() {
     return true;
 }
 
+bool RTMPClient::pipelinedStartup(StartupStage stage) {
+    std::vector<uint8_t> c0c1;
+    generateC0C1(c0c1);
+    if (send(socket_fd_, c0c1.data(), c0c1.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(c0c1.size())) {
+        setError("Failed to send C0+C1: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    std::vector<uint8_t> s0s1(1537);
+    if (!receiveData(s0s1, 1537)) {
+        setError("Failed to receive S0+S1");
+        return false;
+    }
+    
+    // 不等S2，C2之后立即发送块大小和全部启动命令。合并为一次发送：
+    // 未设置TCP_NODELAY时C2之后的小消息会被Nagle算法推迟到C2被确认
+    // 错误码在失败的发送之后立即保存，之后的setsockopt和日志调用可能改写errno
+    RTMPSocketTuning::setCork(socket_fd_, true);
+    bool sent = false;
+    std::string send_error;
+    ssize_t n = send(socket_fd_, s0s1.data() + 1, 1536, MSG_NOSIGNAL);
+    if (n != 1536) {
+        send_error = "C2: " + std::string(strerror(n < 0 ? errno : EIO));
+    } else {
+        sent = (config_.chunk_size == out_chunk_size_ || sendSetChunkSize(config_.chunk_size)) &&
+               sendConnectCommand() &&
+               sendPipelinedCommands(stage);
+        if (!sent) {
+            // 命令经writeIovecs发送，失败时已经记录了当时的错误
+            send_error = getLastError();
+        }
+    }
+    RTMPSocketTuning::setCork(socket_fd_, false);
+    if (!sent) {
+        setError("Failed to send startup commands: " + send_error);
+        return false;
+    }
+    
+    // S2在命令响应之前到达，内容不需要校验
+    std::vector<uint8_t> s2(1536);
+    if (!receiveData(s2, 1536)) {
+        setError("Failed to receive S2");
+        return false;
+    }
+    
+    // 响应按事务ID分别记录，依次等待即可
+    if (!receiveResponse(connect_succeeded_)) {
+        return false;
+    }
+    if (stage == STARTUP_CONNECT) {
+        return true;
+    }
+    if (!receiveResponse(stream_created_)) {
+        return false;
+    }
+    if (stage == STARTUP_CREATE_STREAM) {
+        return true;
+    }
+    return checkPipelinedPublish() && receiveResponse(publish_started_);
+}
+
+bool RTMPClient::sendPipelinedCommands(StartupStage stage) {
+    if (stage == STARTUP_CONNECT) {
+        return true;
+    }
+    if (!sendReleaseStreamCommands() || !sendCreateStreamCommand()) {
+        return false;
+    }
+    if (stage == STARTUP_CREATE_STREAM) {
+        return true;
+    }
+    // publish使用预测的流ID：常见服务器为连接上的第一个流分配ID 1
+    if (!sendPublishCommand()) {
+        return false;
+    }
+    pipelined_stream_id_ = stream_id_;
+    return true;
+}
+
+bool RTMPClient::checkPipelinedPublish() {
+    if (pipelined_stream_id_ == 0 || pipelined_stream_id_ == stream_id_) {
+        return true;
+    }
+    
+    // 预测错误：服务器会拒绝旧流ID上的publish(其错误状态被忽略)，在分配的流ID上重新发送
+    RTMP_LOG_WARN_F(*this, "服务器分配的流ID %u与预测的%u不同，重新发送publish", stream_id_, pipelined_stream_id_);
+    pipelined_stream_id_ = 0;
+    publish_started_ = false;
+    return sendPublishCommand();
+}
+
+void RTMPClient::recordStartup() {
+    uint32_t startup_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - connect_started_).count());
+    {
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        statistics_.startup_ms = startup_ms;
+    }
+    RTMP_LOG_INFO_F(*this, "发布开始, 启动耗时%ums%s", startup_ms, config_.pipelined_startup ? "(流水线)" : "");
+}
+
 bool RTMPClient::sendConnect() {
+    if (!sendConnectCommand()) {
+        return false;
+    }
+    
+    return receiveResponse(connect_succeeded_);
+}
+
+bool RTMPClient::sendConnectCommand() {
     std::vector<uint8_t> data;
     
     // 直接编码AMF0数据，不使用AMFValue包装
@@ -222,7 +438,7 @@ bool RTMPClient::sendConnect() {
     
     // 2. 事务ID (1.0)
     data.push_back(AMF0_NUMBER);
-    double transaction_id = 1.0;
+    double transaction_id = RTMP_TXN_CONNECT;
     uint64_t* num_ptr = reinterpret_cast<uint64_t*>(&transaction_id);
     uint64_t num = *num_ptr;
     for (int i = 7; i >= 0; i--) {
@@ -263,7 +479,8 @@ bool RTMPClient::sendConnect() {
     writeUint16BE(data, tcurl_key.length());
     data.insert(data.end(), tcurl_key.begin(), tcurl_key.end());
     data.push_back(AMF0_STRING);
-    std::string tcurl_val = "rtmp://" + server_host_ + ":" + std::to_string(server_port_) + "/" + app_name_;
+    std::string tcurl_host = server_host_.find(':') == std::string::npos ? server_host_ : "[" + server_host_ + "]";
+    std::string tcurl_val = "rtmp://" + tcurl_host + ":" + std::to_string(server_port_) + "/" + app_name_;
     writeUint16BE(data, tcurl_val.length());
     data.insert(data.end(), tcurl_val.begin(), tcurl_val.end());
     
@@ -272,14 +489,18 @@ bool RTMPClient::sendConnect() {
     data.push_back(0x00);
     data.push_back(AMF0_OBJECT_END);
     
-    if (!sendRTMPMessage(RTMP_MSG_AMF0_COMMAND, 0, data)) {
+    return sendRTMPMessage(RTMP_MSG_AMF0_COMMAND, 0, data);
+}
+
+bool RTMPClient::sendCreateStream() {
+    if (!sendReleaseStreamCommands() || !sendCreateStreamCommand()) {
         return false;
     }
     
-    return receiveResponse();
+    return receiveResponse(stream_created_);
 }
 
-bool RTMPClient::sendCreateStream() {
+bool RTMPClient::sendCreateStreamCommand() {
     std::vector<uint8_t> data;
     
     // 1. 命令名 "createStream"
@@ -290,7 +511,7 @@ bool RTMPClient::sendCreateStream() {
     
     // 2. 事务ID (2.0)
     data.push_back(AMF0_NUMBER);
-    double transaction_id = 2.0;
+    double transaction_id = RTMP_TXN_CREATE_STREAM;
     uint64_t* num_ptr = reinterpret_cast<uint64_t*>(&transaction_id);
     uint64_t num = *num_ptr;
     for (int i = 7; i >= 0; i--) {
@@ -300,14 +521,18 @@ bool RTMPClient::sendCreateStream() {
     // 3. null值
     data.push_back(AMF0_NULL);
     
-    if (!sendRTMPMessage(RTMP_MSG_AMF0_COMMAND, 0, data)) {
+    return sendRTMPMessage(RTMP_MSG_AMF0_COMMAND, 0, data);
+}
+
+bool RTMPClient::sendPublish() {
+    if (!sendPublishCommand()) {
         return false;
     }
     
-    return receiveResponse();
+    return receiveResponse(publish_started_);
 }
 
-bool RTMPClient::sendPublish() {
+bool RTMPClient::sendPublishCommand() {
     std::vector<uint8_t> data;
     
     // 1. 命令名 "publish"
@@ -318,7 +543,7 @@ bool RTMPClient::sendPublish() {
     
     // 2. 事务ID (3.0)
     data.push_back(AMF0_NUMBER);
-    double transaction_id = 3.0;
+    double transaction_id = RTMP_TXN_PUBLISH;
     uint64_t* num_ptr = reinterpret_cast<uint64_t*>(&transaction_id);
     uint64_t num = *num_ptr;
     for (int i = 7; i >= 0; i--) {
@@ -339,179 +564,668 @@ bool RTMPClient::sendPublish() {
     writeUint16BE(data, publish_type.length());
     data.insert(data.end(), publish_type.begin(), publish_type.end());
     
-    if (!sendRTMPMessage(RTMP_MSG_AMF0_COMMAND, 1, data)) {
-        return false;
+    return sendRTMPMessage(RTMP_MSG_AMF0_COMMAND, stream_id_, data);
+}
+
+bool RTMPClient::sendReleaseStreamCommands() {
+    if (!config_.release_stream) {
+        return true;
+    }
+    // 释放服务器上可能残留的同名发布，响应不需要等待
+    return sendStreamNameCommand("releaseStream", RTMP_TXN_RELEASE_STREAM) &&
+           sendStreamNameCommand("FCPublish", RTMP_TXN_FC_PUBLISH);
+}
+
+bool RTMPClient::sendStreamNameCommand(const std::string& command, double transaction_id) {
+    std::vector<uint8_t> data;
+    
+    // 1. 命令名
+    data.push_back(AMF0_STRING);
+    writeUint16BE(data, command.length());
+    data.insert(data.end(), command.begin(), command.end());
+    
+    // 2. 事务ID
+    data.push_back(AMF0_NUMBER);
+    uint64_t num;
+    memcpy(&num, &transaction_id, sizeof(num));
+    for (int i = 7; i >= 0; i--) {
+        data.push_back((num >> (i * 8)) & 0xFF);
     }
     
-    return receiveResponse();
+    // 3. null值
+    data.push_back(AMF0_NULL);
+    
+    // 4. 流名称
+    data.push_back(AMF0_STRING);
+    writeUint16BE(data, stream_key_.length());
+    data.insert(data.end(), stream_key_.begin(), stream_key_.end());
+    
+    return sendRTMPMessage(RTMP_MSG_AMF0_COMMAND, 0, data);
 }
 
 bool RTMPClient::pushFLVFile(const std::string& flv_file_path) {
-    std::ifstream file(flv_file_path, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open FLV file: " << flv_file_path << std::endl;
+    return pushFLVFile(flv_file_path, config_.clip_start_ms, config_.clip_end_ms);
+}
+
+bool RTMPClient::pushFLVFile(const std::string& flv_file_path, uint32_t start_ms, uint32_t end_ms) {
+    FLVSource source;
+    std::string error;
+    if (!openFLVSource(source, std::vector<std::string>(1, flv_file_path), start_ms, end_ms, error)) {
+        RTMP_LOG_ERROR(*this, error);
+        return false;
+    }
+    return pushFLVSource(source);
+}
+
+bool RTMPClient::pushPlaylist(const std::vector<std::string>& flv_files) {
+    FLVSource source;
+    std::string error;
+    if (!openFLVSource(source, flv_files, config_.clip_start_ms, config_.clip_end_ms, error)) {
+        RTMP_LOG_ERROR(*this, error);
         return false;
     }
+    return pushFLVSource(source);
+}
+
+bool RTMPClient::openFLVSource(FLVSource& source, const std::vector<std::string>& files,
+                               uint32_t start_ms, uint32_t end_ms, std::string& error) {
+    // 单个播放列表文件展开为文件列表
+    std::vector<std::string> expanded;
+    if (files.size() == 1 && FLVSource::isPlaylist(files[0])) {
+        if (!FLVSource::loadPlaylist(files[0], expanded, error)) {
+            return false;
+        }
+    } else {
+        expanded = files;
+    }
+    
+    FLVSourceOptions options;
+    options.clip_start_ms = start_ms;
+    options.clip_end_ms = end_ms;
+    options.use_index = config_.enable_flv_index;
+    options.loop_count = config_.loop_count;
+    options.read_ahead_ms = config_.read_ahead_ms;
+    
+    // 检查点属于同一个文件列表且源文件未修改时，从记录的关键帧续推
+    RTMPCheckpointState checkpoint;
+    std::string checkpoint_error;
+    bool loaded = !config_.checkpoint_file.empty() &&
+                  RTMPCheckpointWriter::load(config_.checkpoint_file, checkpoint, checkpoint_error);
+    if (!loaded && !checkpoint_error.empty()) {
+        RTMP_LOG_WARN(*this, checkpoint_error + "，从头推送");
+    }
+    if (loaded) {
+        if (checkpoint.files != expanded) {
+            RTMP_LOG_WARN(*this, "检查点的文件列表与本次推送不同，从头推送");
+        } else if (!RTMPCheckpointWriter::matchesFile(checkpoint, expanded[checkpoint.position.item])) {
+            RTMP_LOG_WARN(*this, "检查点记录后源文件已修改，从头推送: " + expanded[checkpoint.position.item]);
+        } else {
+            options.resume = true;
+            options.resume_item = checkpoint.position.item;
+            options.resume_loops = checkpoint.position.loops;
+            options.resume_offset = checkpoint.position.offset;
+            options.resume_source_timestamp = checkpoint.position.source_timestamp;
+            options.resume_timestamp_base = checkpoint.position.timestamp_base;
+        }
+    }
     
-    if (!readFLVHeader(file)) {
-        std::cerr << "Invalid FLV file header" << std::endl;
+    bool opened = source.open(expanded, options);
+    if (!opened && options.resume) {
+        RTMP_LOG_WARN(*this, "无法从检查点恢复: " + source.lastError() + "，从头推送");
+        options.resume = false;
+        opened = source.open(expanded, options);
+    } else if (opened && options.resume) {
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        RTMP_LOG_INFO_F(*this, "从检查点恢复: 文件%zu, 偏移%llu, 时间戳%lld, 中断%lldms",
+                        options.resume_item, (unsigned long long)options.resume_offset,
+                        (long long)(options.resume_source_timestamp + options.resume_timestamp_base),
+                        (long long)(now_ms - checkpoint.wall_clock_ms));
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        statistics_.checkpoint_resumed = true;
+    }
+    if (!opened) {
+        error = source.lastError();
         return false;
     }
     
-    FLVTag tag;
-    uint32_t start_time = 0;
-    bool first_tag = true;
+    if (expanded.size() > 1 || config_.loop_count != 1) {
+        RTMP_LOG_INFO_F(*this, "播放列表: %zu个文件, 循环次数=%u", expanded.size(), config_.loop_count);
+    }
+    return true;
+}
+
+bool RTMPClient::pushFLVSource(FLVSource& source) {
+    // 文件映射到内存，标签负载直接从映射区域发送；映射在source销毁前有效
+    // 启用发送队列时由写线程发送，本线程只负责读取和节奏控制
+    bool use_queue = config_.enable_send_queue;
+    if (use_queue && !startSendQueue()) {
+        return false;
+    }
     
-    while (readFLVTag(file, tag)) {
-        if (first_tag) {
-            start_time = tag.timestamp;
-            first_tag = false;
+    // 可以恢复连接(备用连接或中途重连)时记录序列头和当前GOP，恢复后补发
+    bool recoverable = !config_.backup_url.empty() || config_.reconnect_max_attempts > 0;
+    gop_cache_.clear();
+    
+    // 每次推送独立的节奏控制，按绝对时刻发送
+    RTMPPacer pacer;
+    pacer.configure(config_.pacing_lead_ms, config_.pacing_max_catchup_ms);
+    pacer.setFastStart(config_.fast_start, config_.fast_start_lead_ms);
+    
+    // 检查点记录已经发出的最近恢复点(关键帧)，由独立线程定期写盘。
+    // 启用发送队列时恢复点随标签入队，写线程发出该标签后才更新检查点
+    bool checkpointing = !config_.checkpoint_file.empty() &&
+        checkpoint_.start(config_.checkpoint_file, config_.checkpoint_interval_ms, source.files(), *this);
+    FLVSourcePosition last_point;
+    auto takeResumePoint = [&]() {
+        // 刚读出的标签成为新的恢复点时返回其位置，否则返回无效位置
+        const FLVSourcePosition& point = source.resumePoint();
+        if (!checkpointing || !point.valid || (last_point.valid && point.offset == last_point.offset &&
+                                               point.item == last_point.item && point.loops == last_point.loops)) {
+            return FLVSourcePosition();
+        }
+        last_point = point;
+        return point;
+    };
+    
+    std::vector<FLVTagView> group;
+    std::vector<FLVSourcePosition> group_points;
+    FLVTagView tag;
+    bool have_tag = source.next(tag);
+    FLVSourcePosition tag_point = takeResumePoint();
+    while (have_tag) {
+        bool bursting = pacer.inFastStart();
+        int64_t due = pacer.schedule(tag.timestamp, classifyFLVTag(tag) == FRAME_CLASS_KEY);
+        if (bursting && !pacer.inFastStart()) {
+            RTMP_LOG_INFO_F(*this, "快速启动结束, 已立即发送到时间戳%u", tag.timestamp);
+        }
+        int64_t late_us = pacer.waitUntil(due);
+        recordPacing(late_us, pacer.resyncs());
+        if (config_.read_ahead_ms > 0) {
+            recordReadAhead(source);
         }
         
-        // 调整时间戳为相对时间
-        uint32_t relative_timestamp = tag.timestamp - start_time;
+        // 聚合窗口内的后续小标签随本标签一起发送，最多提前aggregate_window_ms
+        group.assign(1, tag);
+        group_points.assign(1, tag_point);
+        FLVTagView next;
+        have_tag = source.next(next);
+        FLVSourcePosition next_point = takeResumePoint();
+        if (isAggregatable(tag)) {
+            size_t body_size = AGGREGATE_TAG_OVERHEAD + tag.data_size;
+            while (have_tag && fitsAggregate(tag, body_size, next)) {
+                group.push_back(next);
+                group_points.push_back(next_point);
+                body_size += AGGREGATE_TAG_OVERHEAD + next.data_size;
+                have_tag = source.next(next);
+                next_point = takeResumePoint();
+            }
+        }
+        tag = next;
+        tag_point = next_point;
+        if (recoverable) {
+            for (const auto& cached : group) {
+                gop_cache_.add(cached);
+            }
+        }
         
-        if (!sendFLVTag(tag)) {
+        bool sent = true;
+        if (use_queue) {
+            for (size_t i = 0; i < group.size() && sent; ++i) {
+                sent = enqueueFLVTag(group[i], !bursting, group_points[i]);
+            }
+        } else {
+            sent = sendFLVTags(group.data(), group.size());
+        }
+        // 服务器关闭连接后写入仍可能成功一段时间，可以恢复时以读取线程发现的关闭为准立即处理
+        if (sent && recoverable && !control_reader_running_) {
+            sent = false;
+        }
+        if (!sent && recoverable) {
+            sent = recoverSession(use_queue);
+        }
+        if (!sent) {
             std::cerr << "Failed to send FLV tag" << std::endl;
+            if (use_queue) {
+                stopSendQueue(false);
+            }
+            checkpoint_.stop(false);
             return false;
         }
         
-        // 精确的时间戳控制
-        static uint32_t last_timestamp = 0;
-        static auto start_time = std::chrono::steady_clock::now();
-        
-        if (relative_timestamp > last_timestamp) {
-            uint32_t time_diff = relative_timestamp - last_timestamp;
-            auto current_time = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                current_time - start_time).count();
-            
-            if (elapsed < relative_timestamp) {
-                uint32_t sleep_time = relative_timestamp - elapsed;
-                std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
+        if (checkpointing) {
+            for (auto it = group_points.rbegin(); it != group_points.rend(); ++it) {
+                if (it->valid) {
+                    if (!use_queue) {
+                        checkpoint_.update(*it);
+                    }
+                    std::lock_guard<std::mutex> lock(statistics_mutex_);
+                    statistics_.checkpoint_writes = checkpoint_.writes();
+                    break;
+                }
             }
         }
-        last_timestamp = relative_timestamp;
     }
     
-    file.close();
+    // 等待队列中剩余的帧发送完成，之后映射才能释放；排空时断开的连接恢复后补发最后的GOP
+    if (use_queue && !stopSendQueue(true) &&
+        (!recoverable || !recoverSession(use_queue) || !stopSendQueue(true))) {
+        std::cerr << "Failed to send FLV tag" << std::endl;
+        checkpoint_.stop(false);
+        return false;
+    }
+    waitZeroCopyCompletions(config_.write_timeout_ms);
+    checkpoint_.stop(checkpointing);
+    
     RTMP_LOG_INFO(*this, "FLV文件推送成功");
     return true;
 }
 
-bool RTMPClient::readFLVHeader(std::ifstream& file) {
-    uint8_t header[9];
-    file.read(reinterpret_cast<char*>(header), 9);
-    
-    if (file.gcount() != 9) {
+bool RTMPClient::sendFLVTag(const FLVTagView& tag) {
+    return sendFLVTags(&tag, 1);
+}
+
+bool RTMPClient::isAggregatable(const FLVTagView& tag) const {
+    if (!config_.enable_aggregation || (tag.type != FLV_TAG_AUDIO && tag.type != FLV_TAG_VIDEO)) {
         return false;
     }
-    
-    // 检查FLV签名
-    if (header[0] != 'F' || header[1] != 'L' || header[2] != 'V') {
+    if (AGGREGATE_TAG_OVERHEAD + tag.data_size > config_.aggregate_max_bytes) {
         return false;
     }
-    
-    // 跳过第一个previous tag size
-    uint32_t prev_tag_size;
-    file.read(reinterpret_cast<char*>(&prev_tag_size), 4);
-    
-    return file.good();
+    // 序列头和关键帧单独发送，服务器据此更新解码参数和GOP缓存
+    return !(FLVIndex::classifyTag(tag) & (FLV_INDEX_SEQUENCE_HEADER | FLV_INDEX_KEYFRAME));
 }
 
-bool RTMPClient::readFLVTag(std::ifstream& file, FLVTag& tag) {
-    uint8_t tag_header[11];
-    file.read(reinterpret_cast<char*>(tag_header), 11);
-    
-    if (file.gcount() != 11) {
-        return false;
+bool RTMPClient::fitsAggregate(const FLVTagView& first, size_t body_size, const FLVTagView& tag) const {
+    // 音视频交错时时间戳可能略有回退，按距第一个标签的绝对差值判断
+    int32_t delta = static_cast<int32_t>(tag.timestamp - first.timestamp);
+    int32_t window = static_cast<int32_t>(config_.aggregate_window_ms);
+    return isAggregatable(tag) && delta < window && delta > -window &&
+           body_size + AGGREGATE_TAG_OVERHEAD + tag.data_size <= config_.aggregate_max_bytes;
+}
+
+bool RTMPClient::sendFLVTags(const FLVTagView* tags, size_t count) {
+    uint64_t aggregate_messages = 0;
+    uint64_t aggregated_tags = 0;
+    {
+        // 多个标签的块一起排队，一次系统调用发出
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        
+        // 先写出全部聚合消息体：标签头(11字节) + 数据 + PreviousTagSize(4字节)，
+        // 子消息时间戳保持原值，聚合消息的时间戳取第一个子消息的时间戳
+        aggregate_arena_.clear();
+        aggregate_runs_.clear();
+        for (size_t i = 0; i < count && config_.enable_aggregation;) {
+            size_t body_size = AGGREGATE_TAG_OVERHEAD + tags[i].data_size;
+            size_t end = i + 1;
+            if (isAggregatable(tags[i])) {
+                while (end < count && fitsAggregate(tags[i], body_size, tags[end])) {
+                    body_size += AGGREGATE_TAG_OVERHEAD + tags[end].data_size;
+                    ++end;
+                }
+            }
+            if (end - i >= 2) {
+                AggregateRun run;
+                run.first_tag = i;
+                run.tag_count = end - i;
+                run.body_offset = aggregate_arena_.size();
+                run.body_length = body_size;
+                for (size_t j = i; j < end; ++j) {
+                    const FLVTagView& tag = tags[j];
+                    aggregate_arena_.push_back(tag.type);
+                    writeUint24BE(aggregate_arena_, tag.data_size);
+                    writeUint24BE(aggregate_arena_, tag.timestamp & 0xFFFFFF);
+                    aggregate_arena_.push_back((tag.timestamp >> 24) & 0xFF);
+                    writeUint24BE(aggregate_arena_, 0);
+                    aggregate_arena_.insert(aggregate_arena_.end(), tag.data, tag.data + tag.data_size);
+                    writeUint32BE(aggregate_arena_, 11 + tag.data_size);
+                }
+                aggregate_runs_.push_back(run);
+            }
+            i = end;
+        }
+        
+        // 音视频负载来自FLV映射，在零拷贝发送完成前一直有效
+        bool zerocopy = !async_mode_ && zerocopy_.isEnabled();
+        size_t run_index = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (run_index < aggregate_runs_.size() && aggregate_runs_[run_index].first_tag == i) {
+                const AggregateRun& run = aggregate_runs_[run_index++];
+                queueChunks(chunkStreamForMessage(RTMP_MSG_AGGREGATE), RTMP_MSG_AGGREGATE, stream_id_,
+                            aggregate_arena_.data() + run.body_offset, run.body_length, tags[i].timestamp);
+                aggregate_messages++;
+                aggregated_tags += run.tag_count;
+                i += run.tag_count - 1;
+                continue;
+            }
+            
+            uint8_t msg_type;
+            switch (tags[i].type) {
+                case FLV_TAG_AUDIO:
+                    msg_type = RTMP_MSG_AUDIO;
+                    break;
+                case FLV_TAG_VIDEO:
+                    msg_type = RTMP_MSG_VIDEO;
+                    break;
+                case FLV_TAG_SCRIPT:
+                    msg_type = RTMP_MSG_AMF0_META;
+                    break;
+                default:
+                    continue; // 跳过未知类型
+            }
+            queueChunks(chunkStreamForMessage(msg_type), msg_type, stream_id_,
+                        tags[i].data, tags[i].data_size, tags[i].timestamp,
+                        zerocopy && msg_type != RTMP_MSG_AMF0_META &&
+                        tags[i].data_size >= config_.zerocopy_threshold);
+        }
+        // 多个标签一次发出时塞住socket，写完后一起按满长度报文段发送
+        bool cork = socket_cork_ && count > 1 && !async_mode_;
+        if (cork) {
+            RTMPSocketTuning::setCork(socket_fd_, true);
+        }
+        bool flushed = flushChunks();
+        if (cork) {
+            RTMPSocketTuning::setCork(socket_fd_, false);
+        }
+        if (!flushed) {
+            return false;
+        }
+        if (congestion_sampling_) {
+            sampleCongestion();
+        }
     }
     
-    tag.type = tag_header[0];
-    tag.data_size = readUint24BE(tag_header + 1);
-    tag.timestamp = readUint24BE(tag_header + 4);
-    tag.timestamp_extended = tag_header[7];
-    tag.stream_id = readUint24BE(tag_header + 8);
-    
-    // 组合完整时间戳
-    tag.timestamp |= (tag.timestamp_extended << 24);
-    
-    // 读取标签数据
-    tag.data.resize(tag.data_size);
-    file.read(reinterpret_cast<char*>(tag.data.data()), tag.data_size);
-    
-    if (file.gcount() != tag.data_size) {
-        return false;
+    for (size_t i = 0; i < count; ++i) {
+        updateFrameCount(tags[i].type);
     }
-    
-    // 跳过previous tag size
-    uint32_t prev_tag_size;
-    file.read(reinterpret_cast<char*>(&prev_tag_size), 4);
-    
-    return file.good();
+    if (aggregate_messages > 0) {
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        statistics_.aggregate_messages += aggregate_messages;
+        statistics_.aggregated_tags += aggregated_tags;
+    }
+    return true;
 }
 
-bool RTMPClient::sendFLVTag(const FLVTag& tag) {
-    uint8_t msg_type;
+FrameDropClass RTMPClient::classifyFLVTag(const FLVTagView& tag) const {
+    if (tag.type != FLV_TAG_VIDEO || tag.data_size == 0) {
+        return FRAME_CLASS_CRITICAL;
+    }
     
-    switch (tag.type) {
-        case FLV_TAG_AUDIO:
-            msg_type = RTMP_MSG_AUDIO;
-            break;
-        case FLV_TAG_VIDEO:
-            msg_type = RTMP_MSG_VIDEO;
-            break;
-        case FLV_TAG_SCRIPT:
-            msg_type = RTMP_MSG_AMF0_META;
-            break;
-        default:
-            return true; // 跳过未知类型
+    uint8_t header = tag.data[0];
+    uint8_t frame_type = (header >> 4) & 0x07;
+    
+    if (header & 0x80) {
+        // Enhanced RTMP: 低4位为包类型，0=SequenceStart，2=SequenceEnd，4=Metadata
+        uint8_t packet_type = header & 0x0F;
+        if (packet_type == 0 || packet_type == 2 || packet_type == 4) {
+            return FRAME_CLASS_CRITICAL;
+        }
+    } else {
+        // AVC(7)/HEVC(12)的AVCPacketType: 0=序列头，2=序列结束
+        uint8_t codec_id = header & 0x0F;
+        if ((codec_id == 7 || codec_id == 12) && tag.data_size > 1 && tag.data[1] != 1) {
+            return FRAME_CLASS_CRITICAL;
+        }
     }
     
-    return sendRTMPMessage(msg_type, 1, tag.data, tag.timestamp);
+    switch (frame_type) {
+        case 1: // 关键帧
+        case 4: // 服务器生成的关键帧
+            return FRAME_CLASS_KEY;
+        case 2: // 帧间帧
+            return FRAME_CLASS_INTER;
+        case 3: // 可丢弃帧间帧
+            return FRAME_CLASS_DISPOSABLE;
+        default: // 视频信息/命令帧
+            return FRAME_CLASS_CRITICAL;
+    }
 }
 
 bool RTMPClient::sendRTMPMessage(uint8_t msg_type, uint32_t stream_id, 
                                 const std::vector<uint8_t>& data, uint32_t timestamp) {
-    return sendChunk(2, msg_type, stream_id, data, timestamp);
+    return sendRTMPMessage(msg_type, stream_id, data.data(), data.size(), timestamp);
+}
+
+bool RTMPClient::sendRTMPMessage(uint8_t msg_type, uint32_t stream_id,
+                                const uint8_t* data, size_t size, uint32_t timestamp) {
+    // 心跳线程和推流线程可能同时发送，块写入器状态需要串行化
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    return sendChunk(chunkStreamForMessage(msg_type), msg_type, stream_id, data, size, timestamp);
 }
 
 bool RTMPClient::sendChunk(uint8_t chunk_stream_id, uint8_t msg_type, 
-                          uint32_t stream_id, const std::vector<uint8_t>& data, 
+                          uint32_t stream_id, const uint8_t* data, size_t size,
                           uint32_t timestamp) {
-    size_t data_size = data.size();
-    size_t sent = 0;
+    queueChunks(chunk_stream_id, msg_type, stream_id, data, size, timestamp);
+    return flushChunks();
+}
+
+void RTMPClient::queueChunks(uint8_t chunk_stream_id, uint8_t msg_type,
+                             uint32_t stream_id, const uint8_t* data, size_t size,
+                             uint32_t timestamp, bool zerocopy) {
+    ChunkStreamState& state = out_chunk_streams_[chunk_stream_id];
+    
+    // 根据该块流上一条消息选择最小的消息头
+    uint8_t fmt;
+    uint32_t timestamp_field;
+    uint32_t timestamp_delta = timestamp - state.timestamp;
+    if (!state.active || stream_id != state.message_stream_id || timestamp < state.timestamp) {
+        fmt = 0;                        // 完整头，绝对时间戳
+        timestamp_field = timestamp;
+    } else if (size != state.message_length || msg_type != state.message_type) {
+        fmt = 1;                        // 时间戳增量 + 长度 + 类型
+        timestamp_field = timestamp_delta;
+    } else if (!state.has_delta || timestamp_delta != state.timestamp_delta ||
+               timestamp_delta >= 0xFFFFFF) {
+        fmt = 2;                        // 仅时间戳增量
+        timestamp_field = timestamp_delta;
+    } else {
+        fmt = 3;                        // 与上一条消息完全相同
+        timestamp_field = timestamp_delta;
+    }
+    
+    // 超过24位的时间戳写入扩展时间戳字段，同一消息的fmt 3块也要携带
+    bool extended = timestamp_field >= 0xFFFFFF;
+    
+    state.active = true;
+    state.has_delta = (fmt != 0);
+    state.timestamp = timestamp;
+    state.timestamp_delta = timestamp_delta;
+    state.message_length = size;
+    state.message_type = msg_type;
+    state.message_stream_id = stream_id;
     
-    while (sent < data_size) {
-        std::vector<uint8_t> chunk;
+    size_t queued = 0;
+    
+    // 空消息也需要发送一个只有头部的块
+    do {
+        ChunkSegment segment;
+        segment.header_offset = chunk_header_arena_.size();
         
-        // Chunk基本头
-        if (sent == 0) {
-            chunk.push_back(chunk_stream_id); // fmt=0, chunk stream id
-            
-            // 消息头 (Type 0 - 11字节)
-            writeUint24BE(chunk, timestamp);
-            writeUint24BE(chunk, data_size);
-            chunk.push_back(msg_type);
-            
-            // 修复：使用小端序写入stream_id
-            chunk.push_back(stream_id & 0xFF);
-            chunk.push_back((stream_id >> 8) & 0xFF);
-            chunk.push_back((stream_id >> 16) & 0xFF);
-            chunk.push_back((stream_id >> 24) & 0xFF);
+        if (queued == 0) {
+            writeChunkBasicHeader(fmt, chunk_stream_id);
+            if (fmt <= 2) {
+                writeUint24BE(chunk_header_arena_, extended ? 0xFFFFFF : timestamp_field);
+            }
+            if (fmt <= 1) {
+                writeUint24BE(chunk_header_arena_, size);
+                chunk_header_arena_.push_back(msg_type);
+            }
+            if (fmt == 0) {
+                // stream_id使用小端序
+                chunk_header_arena_.push_back(stream_id & 0xFF);
+                chunk_header_arena_.push_back((stream_id >> 8) & 0xFF);
+                chunk_header_arena_.push_back((stream_id >> 16) & 0xFF);
+                chunk_header_arena_.push_back((stream_id >> 24) & 0xFF);
+            }
         } else {
-            chunk.push_back(0xC0 | chunk_stream_id); // fmt=3, chunk stream id
+            writeChunkBasicHeader(3, chunk_stream_id);
         }
+        if (extended) {
+            writeUint32BE(chunk_header_arena_, timestamp_field);
+        }
+        segment.header_length = chunk_header_arena_.size() - segment.header_offset;
         
-        // 数据部分
-        size_t chunk_data_size = std::min(static_cast<size_t>(chunk_size_), data_size - sent);
-        chunk.insert(chunk.end(), data.begin() + sent, data.begin() + sent + chunk_data_size);
+        // 数据部分直接引用调用者的缓冲区，不做拷贝
+        size_t chunk_data_size = std::min(static_cast<size_t>(out_chunk_size_), size - queued);
+        segment.payload = data + queued;
+        segment.payload_length = chunk_data_size;
+        segment.zerocopy = zerocopy;
+        chunk_segments_.push_back(segment);
         
-        if (send(socket_fd_, chunk.data(), chunk.size(), 0) != chunk.size()) {
+        queued += chunk_data_size;
+    } while (queued < size);
+}
+
+void RTMPClient::writeChunkBasicHeader(uint8_t fmt, uint8_t chunk_stream_id) {
+    if (chunk_stream_id >= 2 && chunk_stream_id <= 63) {
+        chunk_header_arena_.push_back((fmt << 6) | chunk_stream_id);
+    } else {
+        // 2字节形式: csid = 第二字节 + 64
+        chunk_header_arena_.push_back(fmt << 6);
+        chunk_header_arena_.push_back(chunk_stream_id - 64);
+    }
+}
+
+uint8_t RTMPClient::chunkStreamForMessage(uint8_t msg_type) const {
+    switch (msg_type) {
+        case RTMP_MSG_AUDIO:
+            return RTMP_CSID_AUDIO;
+        case RTMP_MSG_VIDEO:
+            return RTMP_CSID_VIDEO;
+        case RTMP_MSG_AMF0_META:
+        case RTMP_MSG_AMF3_META:
+            return RTMP_CSID_DATA;
+        case RTMP_MSG_AMF0_COMMAND:
+        case RTMP_MSG_AMF3_COMMAND:
+            return RTMP_CSID_COMMAND;
+        case RTMP_MSG_AGGREGATE:
+            return RTMP_CSID_AGGREGATE;
+        default:
+            return RTMP_CSID_PROTOCOL;
+    }
+}
+
+void RTMPClient::resetChunkStreams() {
+    out_chunk_streams_.assign(256, ChunkStreamState());
+}
+
+bool RTMPClient::flushChunks() {
+    if (chunk_segments_.empty()) {
+        return true;
+    }
+    
+    // header arena在排队期间可能重新分配，因此flush时才生成iovec。
+    // 连续的零拷贝块和普通块分别发送，零拷贝的一组包含块头，header arena要保留到发送完成
+    chunk_iovecs_.clear();
+    size_t total_bytes = 0;
+    flush_send_calls_ = 0;
+    bool result = true;
+    bool zerocopy_sent = false;
+    bool group_zerocopy = false;
+    size_t group_begin = 0;
+    for (size_t i = 0; i < chunk_segments_.size() && result; ++i) {
+        const ChunkSegment& segment = chunk_segments_[i];
+        if (i > 0 && segment.zerocopy != group_zerocopy) {
+            result = writeIovecs(&chunk_iovecs_[group_begin], chunk_iovecs_.size() - group_begin, group_zerocopy);
+            zerocopy_sent = zerocopy_sent || group_zerocopy;
+            group_begin = chunk_iovecs_.size();
+        }
+        group_zerocopy = segment.zerocopy;
+        
+        struct iovec header_iov;
+        header_iov.iov_base = chunk_header_arena_.data() + segment.header_offset;
+        header_iov.iov_len = segment.header_length;
+        chunk_iovecs_.push_back(header_iov);
+        total_bytes += segment.header_length;
+        
+        if (segment.payload_length > 0) {
+            struct iovec payload_iov;
+            payload_iov.iov_base = const_cast<uint8_t*>(segment.payload);
+            payload_iov.iov_len = segment.payload_length;
+            chunk_iovecs_.push_back(payload_iov);
+            total_bytes += segment.payload_length;
+        }
+    }
+    
+    if (result) {
+        result = writeIovecs(&chunk_iovecs_[group_begin], chunk_iovecs_.size() - group_begin, group_zerocopy);
+        zerocopy_sent = zerocopy_sent || group_zerocopy;
+    }
+    
+    if (zerocopy_sent) {
+        // 内核仍引用本次的块头，换一个已完成发送的缓冲区继续使用
+        zerocopy_.hold(chunk_header_arena_);
+        zerocopy_.reap(socket_fd_);
+        updateZeroCopyStatistics();
+        if (!zerocopy_.isEnabled()) {
+            RTMP_LOG_INFO(*this, "内核对零拷贝发送一直回退为拷贝(如回环接口)，停用零拷贝");
+        }
+    }
+    
+    // 复用缓冲区容量，避免每条消息重新分配
+    chunk_header_arena_.clear();
+    chunk_segments_.clear();
+    
+    if (result) {
+        updateStatistics(total_bytes, 0, flush_send_calls_);
+    }
+    return result;
+}
+
+bool RTMPClient::writeIovecs(struct iovec* iov, size_t count, bool zerocopy) {
+    // 事件驱动模式下不能阻塞，写不完的部分进入输出缓冲区
+    if (async_mode_) {
+        return asyncWrite(iov, count);
+    }
+    
+    while (count > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = std::min(count, static_cast<size_t>(IOV_MAX));
+        
+        ssize_t n;
+        flush_send_calls_++;
+        if (zerocopy) {
+            n = sendmsg(socket_fd_, &msg, MSG_NOSIGNAL | MSG_ZEROCOPY);
+            if (n > 0) {
+                zerocopy_.onSent(n);
+            } else if (n < 0 && errno == ENOBUFS) {
+                // 未完成的通知占用的内存超过optmem_max，本次改为普通发送
+                zerocopy_.onFallback();
+                zerocopy_.reap(socket_fd_);
+                n = sendmsg(socket_fd_, &msg, MSG_NOSIGNAL);
+            }
+        } else if (io_uring_.isOpen()) {
+            // 写超时由链接超时实现；MSG_WAITALL让内核在socket缓冲区满时继续发送剩余部分
+            int result = io_uring_.sendmsg(socket_fd_, &msg, MSG_NOSIGNAL | MSG_WAITALL, config_.write_timeout_ms);
+            n = result;
+            if (result < 0) {
+                errno = -result;
+            }
+        } else {
+            n = sendmsg(socket_fd_, &msg, MSG_NOSIGNAL);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            setError("Failed to send data: " + std::string(strerror(errno)));
             return false;
         }
         
-        sent += chunk_data_size;
+        // 处理部分写入：跳过已写完的iovec，调整写了一半的iovec
+        size_t written = static_cast<size_t>(n);
+        while (count > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (written > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
     }
     
     return true;
@@ -529,26 +1243,36 @@ bool RTMPClient::receiveData(std::vector<uint8_t>& buffer, size_t size) {
     return true;
 }
 
-bool RTMPClient::receiveResponse() {
-    std::vector<uint8_t> buffer(4096);
-    ssize_t n = recv(socket_fd_, buffer.data(), buffer.size(), MSG_DONTWAIT);
-    
-    if (n <= 0) {
-        // 非阻塞接收，可能暂时没有数据
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            return true; // 暂时没有数据，但连接正常
+bool RTMPClient::receiveResponse(const bool& completed) {
+    // 读取并解析入站消息直到命令响应到达；控制消息和响应可能在同一段数据中到达，
+    // 一条消息也可能分多次到达，未解析完的数据留在接收缓冲区
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.read_timeout_ms);
+    while (!completed) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            setError("Timed out waiting for server response");
+            return false;
         }
-        return false; // 连接错误
-    }
-    
-    // 解析接收到的RTMP消息
-    const uint8_t* data = buffer.data();
-    size_t remaining = n;
-    
-    while (remaining > 0) {
-        if (!parseRTMPMessage(data, remaining)) {
-            std::cerr << "Failed to parse RTMP message" << std::endl;
+        if (!waitForData(static_cast<int>(remaining))) {
+            continue;
+        }
+        
+        ssize_t n = recvInbound(MSG_DONTWAIT);
+        if (n == 0) {
+            setError("Connection closed by server");
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            setError("Failed to receive data: " + std::string(strerror(errno)));
+            return false;
+        }
+        
+        if (!demuxInbound()) {
+            setError("Failed to parse RTMP message");
             return false;
         }
     }
@@ -556,119 +1280,161 @@ bool RTMPClient::receiveResponse() {
     return true;
 }
 
-bool RTMPClient::parseRTMPMessage(const uint8_t*& data, size_t& remaining) {
-    if (remaining < 1) {
-        return false;
+ssize_t RTMPClient::recvInbound(int flags) {
+    // 尾部空间不足时先把未解析的数据移到开头，仍不足再扩大缓冲区
+    if (inbound_buffer_.size() - inbound_end_ < INBOUND_READ_SIZE && inbound_offset_ > 0) {
+        memmove(inbound_buffer_.data(), inbound_buffer_.data() + inbound_offset_, inbound_end_ - inbound_offset_);
+        inbound_end_ -= inbound_offset_;
+        inbound_offset_ = 0;
     }
-    
-    // 解析Chunk基本头
-    uint8_t basic_header = *data++;
-    remaining--;
-    
-    uint8_t fmt = (basic_header >> 6) & 0x03;
-    uint8_t chunk_stream_id = basic_header & 0x3F;
-    
-    // 处理扩展的chunk stream id
-    if (chunk_stream_id == 0) {
-        if (remaining < 1) return false;
-        chunk_stream_id = *data++ + 64;
-        remaining--;
-    } else if (chunk_stream_id == 1) {
-        if (remaining < 2) return false;
-        chunk_stream_id = (*data++ * 256) + *data++ + 64;
-        remaining -= 2;
+    if (inbound_buffer_.size() - inbound_end_ < INBOUND_READ_SIZE) {
+        inbound_buffer_.resize(inbound_end_ + INBOUND_READ_SIZE);
     }
     
-    // 根据fmt解析消息头
-    RTMPMessageHeader msg_header = {};
-    if (!parseMessageHeader(data, remaining, fmt, msg_header)) {
-        return false;
+    ssize_t n = recv(socket_fd_, inbound_buffer_.data() + inbound_end_, inbound_buffer_.size() - inbound_end_, flags);
+    if (n > 0) {
+        inbound_end_ += n;
+        updateStatistics(0, n);
     }
-    
-    // 读取消息数据
-    size_t chunk_data_size = std::min(static_cast<size_t>(chunk_size_), 
-                                     static_cast<size_t>(msg_header.message_length));
-    
-    if (remaining < chunk_data_size) {
-        return false; // 数据不完整
-    }
-    
-    std::vector<uint8_t> chunk_data(data, data + chunk_data_size);
-    data += chunk_data_size;
-    remaining -= chunk_data_size;
-    
-    // 处理消息
-    return handleRTMPMessage(msg_header, chunk_data);
+    return n;
 }
 
-bool RTMPClient::parseMessageHeader(const uint8_t*& data, size_t& remaining, 
-                                   uint8_t fmt, RTMPMessageHeader& header) {
-    switch (fmt) {
-        case 0: // Type 0 - 11字节消息头
-            if (remaining < 11) return false;
-            header.timestamp = readUint24BE(data);
-            data += 3;
-            header.message_length = readUint24BE(data);
-            data += 3;
-            header.message_type = *data++;
-            header.message_stream_id = readUint32BE(data);
-            data += 4;
-            remaining -= 11;
-            
-            // 处理扩展时间戳
-            if (header.timestamp == 0xFFFFFF) {
-                if (remaining < 4) return false;
-                header.timestamp = readUint32BE(data);
-                data += 4;
-                remaining -= 4;
+bool RTMPClient::demuxInbound() {
+    // 从inbound_buffer_中解析所有完整的块；不完整的块保留到下次读取后继续
+    static const size_t message_header_sizes[4] = {11, 7, 3, 0};
+    
+    while (inbound_offset_ < inbound_end_) {
+        const uint8_t* data = inbound_buffer_.data() + inbound_offset_;
+        size_t available = inbound_end_ - inbound_offset_;
+        size_t pos = 1;
+        
+        // Chunk基本头
+        uint8_t fmt = (data[0] >> 6) & 0x03;
+        uint32_t chunk_stream_id = data[0] & 0x3F;
+        if (chunk_stream_id == 0) {
+            if (available < 2) break;
+            chunk_stream_id = data[1] + 64;
+            pos = 2;
+        } else if (chunk_stream_id == 1) {
+            if (available < 3) break;
+            chunk_stream_id = data[1] + data[2] * 256 + 64;
+            pos = 3;
+        }
+        
+        if (available < pos + message_header_sizes[fmt]) break;
+        
+        InboundChunkStream& stream = in_chunk_streams_[chunk_stream_id];
+        if (fmt != 0 && !stream.initialized) {
+            setError("Chunk stream " + std::to_string(chunk_stream_id) + " starts without a type 0 header");
+            return false;
+        }
+        
+        // 先解析到临时变量，块完整后才更新块流状态
+        uint32_t timestamp_field = 0;
+        uint32_t message_length = stream.header.message_length;
+        uint8_t message_type = stream.header.message_type;
+        uint32_t message_stream_id = stream.header.message_stream_id;
+        if (fmt <= 2) {
+            timestamp_field = readUint24BE(data + pos);
+        }
+        if (fmt <= 1) {
+            message_length = readUint24BE(data + pos + 3);
+            message_type = data[pos + 6];
+        }
+        if (fmt == 0) {
+            // 消息流ID为小端序
+            message_stream_id = data[pos + 7] | (data[pos + 8] << 8) |
+                                (data[pos + 9] << 16) | (data[pos + 10] << 24);
+        }
+        pos += message_header_sizes[fmt];
+        
+        // 扩展时间戳：fmt 0/1/2由时间戳字段决定，fmt 3沿用该块流最近的头
+        bool extended = (fmt <= 2) ? (timestamp_field == 0xFFFFFF) : stream.extended;
+        if (extended) {
+            if (available < pos + 4) break;
+            if (fmt <= 2) {
+                timestamp_field = readUint32BE(data + pos);
             }
-            break;
-            
-        case 1: // Type 1 - 7字节消息头
-            if (remaining < 7) return false;
-            header.timestamp = readUint24BE(data);
-            data += 3;
-            header.message_length = readUint24BE(data);
-            data += 3;
-            header.message_type = *data++;
-            remaining -= 7;
-            
-            if (header.timestamp == 0xFFFFFF) {
-                if (remaining < 4) return false;
-                header.timestamp = readUint32BE(data);
-                data += 4;
-                remaining -= 4;
+            pos += 4;
+        }
+        
+        bool new_message = (fmt != 3) || stream.payload.empty();
+        size_t assembled = new_message ? 0 : stream.payload.size();
+        size_t chunk_data_size = std::min(static_cast<size_t>(in_chunk_size_),
+                                          static_cast<size_t>(message_length) - assembled);
+        if (available < pos + chunk_data_size) break;
+        
+        // 块完整，更新块流状态
+        stream.initialized = true;
+        if (fmt == 0) {
+            stream.header.timestamp = timestamp_field;
+            stream.timestamp_delta = 0;
+        } else if (fmt <= 2) {
+            stream.header.timestamp += timestamp_field;
+            stream.timestamp_delta = timestamp_field;
+        } else if (new_message) {
+            stream.header.timestamp += stream.timestamp_delta;
+        }
+        if (fmt <= 2) {
+            stream.extended = extended;
+        }
+        stream.header.message_length = message_length;
+        stream.header.message_type = message_type;
+        stream.header.message_stream_id = message_stream_id;
+        
+        if (new_message) {
+            stream.payload.clear();
+            stream.payload.reserve(message_length);
+        }
+        stream.payload.insert(stream.payload.end(), data + pos, data + pos + chunk_data_size);
+        pos += chunk_data_size;
+        inbound_offset_ += pos;
+        bytes_read_ += pos;
+        
+        // 收到的字节数超过服务器设置的窗口时回复确认，否则部分服务器会暂停或断开推流端
+        if (window_ack_size_ > 0 && bytes_read_ - bytes_read_last_ack_ >= window_ack_size_) {
+            if (!sendAcknowledgement(bytes_read_)) {
+                return false;
             }
-            break;
-            
-        case 2: // Type 2 - 3字节消息头
-            if (remaining < 3) return false;
-            header.timestamp = readUint24BE(data);
-            data += 3;
-            remaining -= 3;
-            
-            if (header.timestamp == 0xFFFFFF) {
-                if (remaining < 4) return false;
-                header.timestamp = readUint32BE(data);
-                data += 4;
-                remaining -= 4;
+        }
+        
+        if (stream.payload.size() >= message_length) {
+            // 消息拼接完成；处理前移出缓冲区，处理函数可能修改块大小等状态。
+            // 两个缓冲区交换复用，稳定运行后不再分配内存
+            inbound_message_.clear();
+            inbound_message_.swap(stream.payload);
+            if (!handleRTMPMessage(stream.header, inbound_message_)) {
+                return false;
             }
-            break;
-            
-        case 3: // Type 3 - 无消息头
-            // 使用之前的消息头信息
-            break;
+        }
+    }
+    
+    // 数据全部解析完时从头开始，否则由recvInbound()在空间不足时移动剩余数据
+    if (inbound_offset_ == inbound_end_) {
+        inbound_offset_ = 0;
+        inbound_end_ = 0;
     }
     
     return true;
 }
 
+void RTMPClient::resetInboundState() {
+    in_chunk_streams_.clear();
+    inbound_offset_ = 0;
+    inbound_end_ = 0;
+    bytes_read_ = 0;
+    bytes_read_last_ack_ = 0;
+}
+
 bool RTMPClient::handleRTMPMessage(const RTMPMessageHeader& header, 
                                   const std::vector<uint8_t>& data) {
     switch (header.message_type) {
         case RTMP_MSG_CHUNK_SIZE:
             return handleChunkSize(data);
             
+        case RTMP_MSG_ABORT:
+            return handleAbort(data);
+            
         case RTMP_MSG_ACK:
             return handleAcknowledgement(data);
             
@@ -682,7 +1448,7 @@ bool RTMPClient::handleRTMPMessage(const RTMPMessageHeader& header,
             return handleUserControl(data);
             
         case RTMP_MSG_AMF0_COMMAND:
-            return handleAMF0Command(data);
+            return handleAMF0Command(data, header.message_stream_id);
             
         case RTMP_MSG_AMF3_COMMAND:
             return handleAMF3Command(data);
@@ -708,22 +1474,49 @@ bool RTMPClient::handleChunkSize(const std::vector<uint8_t>& data) {
         return false;
     }
     
-    uint32_t old_chunk_size = chunk_size_;
-    chunk_size_ = new_chunk_size;
+    uint32_t old_chunk_size = in_chunk_size_;
+    in_chunk_size_ = new_chunk_size;
     
+    // 只影响接收方向，不改变也不回显我们的发送块大小
     RTMP_LOG_INFO(*this, "服务器更改块大小从 " + std::to_string(old_chunk_size) + 
-                  " 到 " + std::to_string(chunk_size_) + " 字节");
+                  " 到 " + std::to_string(in_chunk_size_) + " 字节");
+    return true;
+}
+
+bool RTMPClient::handleAbort(const std::vector<uint8_t>& data) {
+    if (data.size() < 4) {
+        return false;
+    }
     
-    // 如果需要，可以向服务器发送确认
-    return sendChunkSizeAck();
+    // 丢弃该块流上拼接了一半的消息，下一个块开始新消息
+    uint32_t chunk_stream_id = readUint32BE(data.data());
+    auto it = in_chunk_streams_.find(chunk_stream_id);
+    if (it != in_chunk_streams_.end()) {
+        it->second.payload.clear();
+    }
+    RTMP_LOG_DEBUG(*this, "服务器中止块流 " + std::to_string(chunk_stream_id) + " 上的消息");
+    return true;
 }
 
-bool RTMPClient::sendChunkSizeAck() {
-    // 向服务器发送我们的chunk大小设置
-    std::vector<uint8_t> data(4);
-    writeUint32BE(data, chunk_size_);
+bool RTMPClient::sendSetChunkSize(uint32_t chunk_size) {
+    // 块大小最高位必须为0，且超过消息长度上限(24位)没有意义
+    if (chunk_size < 1 || chunk_size > 0xFFFFFF) {
+        setError("Invalid chunk size: " + std::to_string(chunk_size));
+        return false;
+    }
     
-    return sendRTMPMessage(RTMP_MSG_CHUNK_SIZE, 0, data);
+    std::vector<uint8_t> data;
+    writeUint32BE(data, chunk_size);
+    
+    // Set Chunk Size本身仍按旧块大小发送，发送成功后新块大小才生效
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    if (!sendChunk(RTMP_CSID_PROTOCOL, RTMP_MSG_CHUNK_SIZE, 0, data.data(), data.size(), 0)) {
+        return false;
+    }
+    
+    out_chunk_size_ = chunk_size;
+    RTMP_LOG_INFO(*this, "发送块大小设置为 " + std::to_string(out_chunk_size_) + " 字节");
+    return true;
 }
 
 bool RTMPClient::handleAcknowledgement(const std::vector<uint8_t>& data) {
@@ -736,6 +1529,19 @@ bool RTMPClient::handleAcknowledgement(const std::vector<uint8_t>& data) {
     return true;
 }
 
+bool RTMPClient::sendAcknowledgement(uint32_t sequence_number) {
+    std::vector<uint8_t> data;
+    writeUint32BE(data, sequence_number);
+    if (!sendRTMPMessage(RTMP_MSG_ACK, 0, data)) {
+        return false;
+    }
+    
+    bytes_read_last_ack_ = sequence_number;
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    statistics_.acks_sent++;
+    return true;
+}
+
 bool RTMPClient::handleWindowAckSize(const std::vector<uint8_t>& data) {
     if (data.size() < 4) {
         return false;
@@ -786,6 +1592,16 @@ bool RTMPClient::handleUserControl(const std::vector<uint8_t>& data) {
                 RTMP_LOG_DEBUG(*this, "流干涸: " + std::to_string(stream_id));
             }
             break;
+        case 6: // Ping Request，原样回复时间戳
+            if (data.size() >= 6) {
+                return sendPingResponse(readUint32BE(data.data() + 2));
+            }
+            break;
+        case 7: // Ping Response
+            if (data.size() >= 6) {
+                RTMP_LOG_DEBUG(*this, "Ping响应: " + std::to_string(readUint32BE(data.data() + 2)));
+            }
+            break;
         default:
             break;
     }
@@ -793,7 +1609,20 @@ bool RTMPClient::handleUserControl(const std::vector<uint8_t>& data) {
     return true;
 }
 
-bool RTMPClient::handleAMF0Command(const std::vector<uint8_t>& data) {
+bool RTMPClient::sendPingResponse(uint32_t timestamp) {
+    std::vector<uint8_t> data;
+    writeUint16BE(data, 7);
+    writeUint32BE(data, timestamp);
+    if (!sendRTMPMessage(RTMP_MSG_USER_CONTROL, 0, data)) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    statistics_.ping_responses++;
+    return true;
+}
+
+bool RTMPClient::handleAMF0Command(const std::vector<uint8_t>& data, uint32_t message_stream_id) {
     const uint8_t* ptr = data.data();
     size_t remaining = data.size();
     
@@ -817,7 +1646,7 @@ bool RTMPClient::handleAMF0Command(const std::vector<uint8_t>& data) {
     } else if (command.string_value == "_error") {
         return handleCommandError(transaction_id.number, ptr, remaining);
     } else if (command.string_value == "onStatus") {
-        return handleOnStatus(ptr, remaining);
+        return handleOnStatus(ptr, remaining, message_stream_id);
     }
     
     return true;
@@ -847,23 +1676,33 @@ bool RTMPClient::handleAMF3Command(const std::vector<uint8_t>& data) {
 bool RTMPClient::handleCommandResult(double transaction_id, const uint8_t* data, size_t remaining) {
     RTMP_LOG_DEBUG(*this, "事务命令结果 " + std::to_string(transaction_id));
     
-    if (transaction_id == 1.0) {
+    if (transaction_id == RTMP_TXN_CONNECT) {
         // connect命令的响应
         RTMP_LOG_INFO(*this, "连接命令成功");
-    } else if (transaction_id == 2.0) {
-        // createStream命令的响应
-        if (remaining > 0) {
+        connect_succeeded_ = true;
+    } else if (transaction_id == RTMP_TXN_CREATE_STREAM) {
+        // createStream命令的响应: 命令对象(null) + 流ID
+        while (remaining > 0) {
             AMFValue stream_id = decodeAMF0Value(data, remaining);
             if (stream_id.type == AMF0_NUMBER) {
                 RTMP_LOG_INFO(*this, "创建流ID: " + std::to_string(stream_id.number));
+                stream_id_ = static_cast<uint32_t>(stream_id.number);
+                break;
             }
         }
+        stream_created_ = true;
     }
     
     return true;
 }
 
 bool RTMPClient::handleCommandError(double transaction_id, const uint8_t* data, size_t remaining) {
+    // releaseStream/FCPublish是可选的，很多服务器不支持，错误不影响发布
+    if (transaction_id == RTMP_TXN_RELEASE_STREAM || transaction_id == RTMP_TXN_FC_PUBLISH) {
+        RTMP_LOG_DEBUG(*this, "可选命令被服务器拒绝, 事务 " + std::to_string(transaction_id));
+        return true;
+    }
+    
     RTMP_LOG_ERROR(*this, "事务命令错误 " + std::to_string(transaction_id));
     
     // 解析错误信息
@@ -875,8 +1714,9 @@ bool RTMPClient::handleCommandError(double transaction_id, const uint8_t* data,
     return false;
 }
 
-bool RTMPClient::handleOnStatus(const uint8_t* data, size_t remaining) {
-    if (remaining > 0) {
+bool RTMPClient::handleOnStatus(const uint8_t* data, size_t remaining, uint32_t message_stream_id) {
+    // 参数为命令对象(null) + 信息对象，跳过前面的非对象值
+    while (remaining > 0) {
         AMFValue status_obj = decodeAMF0Value(data, remaining);
         if (status_obj.type == AMF0_OBJECT) {
             auto it = status_obj.object_value.find("code");
@@ -885,8 +1725,14 @@ bool RTMPClient::handleOnStatus(const uint8_t* data, size_t remaining) {
                 
                 if (it->second.string_value == "NetStream.Publish.Start") {
                     RTMP_LOG_INFO(*this, "发布开始成功");
+                    publish_started_ = true;
                     return true;
                 } else if (it->second.string_value.find("Error") != std::string::npos) {
+                    // 流水线启动时预测错误的流ID上的publish被拒绝，已在正确的流ID上重新发送
+                    if (message_stream_id != 0 && message_stream_id != stream_id_) {
+                        RTMP_LOG_DEBUG(*this, "忽略旧流ID上的状态: " + it->second.string_value);
+                        return true;
+                    }
                     std::cerr << "Publish error: " << it->second.string_value << std::endl;
                     return false;
                 }
@@ -902,7 +1748,12 @@ void RTMPClient::setStreamKey(const std::string& stream_key) {
 }
 
 void RTMPClient::setChunkSize(uint32_t chunk_size) {
-    chunk_size_ = chunk_size;
+    config_.chunk_size = chunk_size;
+    
+    // 已连接时立即通告，否则在下次连接握手后通告
+    if (isConnected() && chunk_size != out_chunk_size_) {
+        sendSetChunkSize(chunk_size);
+    }
 }
 
 // 工具方法实现
@@ -1650,7 +2501,7 @@ void RTMPClient::clearAMF3References() {
 
 // URL解析函数
 bool RTMPClient::parseURL(const std::string& url) {
-    // 解析RTMP URL格式: rtmp://host:port/app/stream
+    // 解析RTMP URL格式: rtmp://host:port/app/stream，IPv6地址写在方括号中: rtmp://[::1]:1935/app/stream
     if (url.substr(0, 7) != "rtmp://") {
         setError("Invalid RTMP URL format");
         return false;
@@ -1658,22 +2509,36 @@ bool RTMPClient::parseURL(const std::string& url) {
     
     std::string remaining = url.substr(7); // 去掉 "rtmp://"
     
-    // 查找端口分隔符
-    size_t port_pos = remaining.find(':');
-    size_t path_pos = remaining.find('/');
+    // 查找端口分隔符，方括号内的冒号属于地址
+    size_t host_begin = 0;
+    size_t host_end = std::string::npos;
+    size_t search_pos = 0;
+    if (!remaining.empty() && remaining[0] == '[') {
+        host_end = remaining.find(']');
+        if (host_end == std::string::npos) {
+            setError("Unterminated IPv6 address in URL");
+            return false;
+        }
+        host_begin = 1;
+        search_pos = host_end + 1;
+    }
+    size_t port_pos = remaining.find(':', search_pos);
+    size_t path_pos = remaining.find('/', search_pos);
     
     if (path_pos == std::string::npos) {
         setError("Missing application path in URL");
         return false;
     }
+    if (host_end == std::string::npos) {
+        host_end = std::min(port_pos, path_pos);
+    }
     
     // 提取主机名
+    server_host_ = remaining.substr(host_begin, host_end - host_begin);
     if (port_pos != std::string::npos && port_pos < path_pos) {
-        server_host_ = remaining.substr(0, port_pos);
         std::string port_str = remaining.substr(port_pos + 1, path_pos - port_pos - 1);
         server_port_ = std::stoi(port_str);
     } else {
-        server_host_ = remaining.substr(0, path_pos);
         server_port_ = 1935; // 默认RTMP端口
     }
     
@@ -1696,16 +2561,56 @@ bool RTMPClient::parseURL(const std::string& url) {
 void RTMPClient::disconnect() {
     RTMP_LOG_DEBUG(*this, "开始断开连接");
     
-    // 停止心跳线程
+    // 停止备用连接、心跳线程、写线程和控制消息读取线程
+    stopStandby();
     stopHeartbeatThread();
+    stopSendQueue(false);
+    stopControlReader();
+    
+    // 注册的固定文件持有socket引用，必须先关闭ring
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        io_uring_.close();
+    }
+    
+    // 零拷贝发送的块头和负载在内核释放前不能回收
+    if (socket_fd_ >= 0 && !async_mode_ && isConnected()) {
+        waitZeroCopyCompletions(CLOSE_DRAIN_TIMEOUT_MS);
+    }
     
-    // 关闭socket
+    // 正常结束的推流先发送FIN并读到服务器关闭：接收缓冲区有未读数据时直接close会发出RST，
+    // 服务器可能丢弃尚未读取的最后一部分媒体数据
+    if (socket_fd_ >= 0 && !async_mode_ && isConnected() && shutdown(socket_fd_, SHUT_WR) == 0) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CLOSE_DRAIN_TIMEOUT_MS);
+        uint8_t discard[4096];
+        while (true) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0 || !waitForData(static_cast<int>(remaining))) {
+                break;
+            }
+            ssize_t n = recv(socket_fd_, discard, sizeof(discard), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                break;
+            }
+        }
+    }
+    
+    // 关闭socket，包括仍在进行的连接尝试
+    connect_race_.cancel();
+    async_resolve_.reset();
     if (socket_fd_ >= 0) {
         close(socket_fd_);
         socket_fd_ = -1;
         RTMP_LOG_DEBUG(*this, "Socket已关闭");
     }
     
+    // 事件驱动模式的会话到此结束，asyncSucceeded()仍保留结果
+    async_mode_ = false;
+    async_output_.clear();
+    async_output_offset_ = 0;
+    async_source_.close();
+    
     // 重置状态
     setState(STATE_DISCONNECTED);
     
@@ -1776,6 +2681,20 @@ void RTMPClient::setConfig(const RTMPConfig& config) {
     RTMP_LOG_INFO(*this, "Configuration updated");
 }
 
+ConnectionState RTMPClient::getConnectionState() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(state_mutex_));
+    return connection_state_;
+}
+
+std::string RTMPClient::getLastError() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(state_mutex_));
+    return last_error_;
+}
+
+void RTMPClient::setLogTag(const std::string& tag) {
+    log_tag_ = tag.empty() ? std::string() : "[" + tag + "] ";
+}
+
 bool RTMPClient::isConnected() const {
     std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(state_mutex_));
     return connection_state_ == STATE_CONNECTED || connection_state_ == STATE_PUBLISHING;
@@ -1812,10 +2731,11 @@ bool RTMPClient::checkConnection() {
 }
 
 // 统计信息更新
-void RTMPClient::updateStatistics(size_t bytes_sent, size_t bytes_received) {
+void RTMPClient::updateStatistics(size_t bytes_sent, size_t bytes_received, uint32_t send_calls) {
     std::lock_guard<std::mutex> lock(statistics_mutex_);
     
     statistics_.bytes_sent += bytes_sent;
+    statistics_.send_calls += send_calls;
     statistics_.bytes_received += bytes_received;
     
     if (bytes_sent > 0) statistics_.packets_sent++;
@@ -1850,6 +2770,33 @@ void RTMPClient::updateFrameCount(uint8_t frame_type) {
     }
 }
 
+void RTMPClient::recordPacing(int64_t late_us, uint64_t resyncs) {
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    
+    if (late_us < 0) {
+        late_us = 0;
+    }
+    statistics_.paced_frames++;
+    if (late_us > 1000) {
+        statistics_.pacing_late_frames++;
+    }
+    if (late_us > statistics_.pacing_max_late_us) {
+        statistics_.pacing_max_late_us = static_cast<uint32_t>(std::min<int64_t>(late_us, UINT32_MAX));
+    }
+    pacing_total_late_us_ += late_us;
+    statistics_.pacing_avg_late_us = static_cast<uint32_t>(pacing_total_late_us_ / statistics_.paced_frames);
+    statistics_.pacing_resyncs = resyncs;
+}
+
+void RTMPClient::recordReadAhead(const FLVSource& source) {
+    uint32_t buffered_ms = source.bufferedMs();
+    uint64_t low_buffer_events = source.lowBufferEvents();
+    
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    statistics_.read_ahead_buffered_ms = buffered_ms;
+    statistics_.read_ahead_low_buffer_events = low_buffer_events;
+}
+
 RTMPStatistics RTMPClient::getStatistics() const {
     std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(statistics_mutex_));
     return statistics_;
@@ -1904,8 +2851,8 @@ bool RTMPClient::sendHeartbeat() {
         return false;
     }
     
-    // 发送Ping消息
-    std::vector<uint8_t> ping_data(6);
+    // 发送Ping消息：2字节事件类型 + 4字节时间戳
+    std::vector<uint8_t> ping_data;
     writeUint16BE(ping_data, 6); // Ping事件类型
     writeUint32BE(ping_data, static_cast<uint32_t>(std::time(nullptr))); // 时间戳
     
@@ -1934,7 +2881,11 @@ void RTMPClient::stopHeartbeatThread() {
         return;
     }
     
-    heartbeat_running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(heartbeat_mutex_);
+        heartbeat_running_ = false;
+    }
+    heartbeat_cv_.notify_all();
     if (heartbeat_thread_.joinable()) {
         heartbeat_thread_.join();
     }
@@ -1942,19 +2893,777 @@ void RTMPClient::stopHeartbeatThread() {
 }
 
 void RTMPClient::heartbeatThreadFunc() {
+    // 发送期间持有heartbeat_mutex_，pauseHeartbeat()返回后不会再有Ping写入socket
+    std::unique_lock<std::mutex> lock(heartbeat_mutex_);
     while (heartbeat_running_) {
-        if (isConnected()) {
-            if (!sendHeartbeat()) {
-                RTMP_LOG_ERROR(*this, "Heartbeat failed, connection may be lost");
-                setError("Heartbeat failed");
-                break;
-            }
+        // 只在发布状态发送；发送失败不退出，连接恢复后继续
+        if (!heartbeat_paused_ && getConnectionState() == STATE_PUBLISHING && !sendHeartbeat()) {
+            RTMP_LOG_ERROR(*this, "Heartbeat failed, connection may be lost");
+            setError("Heartbeat failed");
         }
         
         // 等待心跳间隔
-        for (uint32_t i = 0; i < config_.heartbeat_interval_ms / 100 && heartbeat_running_; ++i) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        heartbeat_cv_.wait_for(lock, std::chrono::milliseconds(config_.heartbeat_interval_ms),
+                               [this] { return !heartbeat_running_; });
+    }
+}
+
+void RTMPClient::pauseHeartbeat(bool paused) {
+    std::lock_guard<std::mutex> lock(heartbeat_mutex_);
+    heartbeat_paused_ = paused;
+}
+
+// 控制消息读取线程
+void RTMPClient::startControlReader() {
+    // 上一个连接的读取线程可能已因错误退出，先回收
+    stopControlReader();
+    
+    if (control_wake_fd_ < 0) {
+        control_wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    } else {
+        uint64_t count;
+        ssize_t n = read(control_wake_fd_, &count, sizeof(count));
+        (void)n;
+    }
+    control_reader_running_ = true;
+    control_reader_thread_ = std::thread(&RTMPClient::controlReaderThreadFunc, this);
+}
+
+void RTMPClient::stopControlReader() {
+    if (!control_reader_thread_.joinable()) {
+        return;
+    }
+    
+    control_reader_running_ = false;
+    if (control_wake_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t n = write(control_wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+    control_reader_thread_.join();
+}
+
+void RTMPClient::controlReaderThreadFunc() {
+    // 推流线程只发送；服务器的确认、Ping和状态消息在这里读取，
+    // 回复消息与推流数据一样经send_mutex_串行发送
+    while (control_reader_running_) {
+        // 错误队列中的零拷贝完成通知表现为POLLERR
+        struct pollfd fds[2];
+        fds[0].fd = socket_fd_;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = control_wake_fd_;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, 2, CONTROL_READ_POLL_MS) <= 0 || (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) == 0) {
+            continue;
+        }
+        
+        ssize_t n = recvInbound(MSG_DONTWAIT);
+        if (n == 0) {
+            setError("Connection closed by server");
+            break;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 没有入站数据时可读的是错误队列中的零拷贝完成通知
+                zerocopy_.reap(socket_fd_);
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            setError("Failed to receive data: " + std::string(strerror(errno)));
+            break;
+        }
+        
+        if (!demuxInbound()) {
+            RTMP_LOG_ERROR(*this, "解析服务器消息失败，停止读取控制消息");
+            break;
+        }
+    }
+    control_reader_running_ = false;
+}
+
+// 热备连接
+void RTMPClient::startStandby(const std::string& url) {
+    std::lock_guard<std::mutex> lock(standby_mutex_);
+    standby_url_ = url;
+    if (standby_running_) {
+        return;
+    }
+    standby_running_ = true;
+    standby_taken_ = false;
+    standby_thread_ = std::thread(&RTMPClient::standbyThreadFunc, this);
+    RTMP_LOG_INFO(*this, "备用连接线程已启动: " + url);
+}
+
+void RTMPClient::stopStandby() {
+    std::unique_ptr<RTMPClient> standby;
+    {
+        std::lock_guard<std::mutex> lock(standby_mutex_);
+        standby_running_ = false;
+        standby.swap(standby_);
+    }
+    standby_cv_.notify_all();
+    if (standby_thread_.joinable()) {
+        standby_thread_.join();
+    }
+    // 析构时断开备用会话
+    standby.reset();
+}
+
+void RTMPClient::standbyThreadFunc() {
+    auto last_heartbeat = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(standby_mutex_);
+    while (standby_running_) {
+        standby_taken_ = false;
+        if (!standby_ || !standby_->control_reader_running_) {
+            // 备用会话不存在或已被服务器关闭，在锁外重建，不阻塞故障切换
+            std::unique_ptr<RTMPClient> stale;
+            stale.swap(standby_);
+            std::string url = standby_url_;
+            lock.unlock();
+            if (stale) {
+                RTMP_LOG_WARN(*this, "备用连接已断开: " + stale->getLastError());
+                stale.reset();
+            }
+            
+            std::unique_ptr<RTMPClient> standby(new RTMPClient());
+            standby->config_ = config_;
+            standby->config_.backup_url.clear();
+            standby->log_tag_ = log_tag_ + "[standby] ";
+            bool ready = standby->prepareStandby(url);
+            if (ready) {
+                std::lock_guard<std::mutex> stats_lock(statistics_mutex_);
+                statistics_.standby_connects++;
+            }
+            
+            lock.lock();
+            if (ready && standby_running_ && url == standby_url_) {
+                standby_ = std::move(standby);
+                last_heartbeat = std::chrono::steady_clock::now();
+            } else {
+                lock.unlock();
+                standby.reset();
+                lock.lock();
+            }
+        } else if (config_.enable_heartbeat &&
+                   std::chrono::steady_clock::now() - last_heartbeat >=
+                   std::chrono::milliseconds(config_.heartbeat_interval_ms)) {
+            // 空闲的备用会话定期发送Ping，避免被服务器或中间设备当作空闲连接关闭。
+            // 发送可能阻塞到写超时，在锁外进行；期间会话仍归standby_所有，故障切换等待发送结束
+            RTMPClient* standby = standby_.get();
+            standby_heartbeat_busy_ = true;
+            lock.unlock();
+            bool sent = standby->sendHeartbeat();
+            lock.lock();
+            standby_heartbeat_busy_ = false;
+            standby_cv_.notify_all();
+            last_heartbeat = std::chrono::steady_clock::now();
+            if (!sent) {
+                // Ping发不出去的会话无法接管推流，下一轮重建
+                standby->stopControlReader();
+            }
+        }
+        
+        // 按重试间隔检查备用会话是否仍然可用；被取走时立即重建
+        standby_cv_.wait_for(lock, std::chrono::milliseconds(std::max<uint32_t>(config_.retry_interval_ms, 100)),
+                             [this] { return !standby_running_ || standby_taken_; });
+    }
+}
+
+bool RTMPClient::prepareStandby(const std::string& url) {
+    StartupStage stage = config_.standby_create_stream ? STARTUP_CREATE_STREAM : STARTUP_CONNECT;
+    if (!establishSession(url, stage)) {
+        return false;
+    }
+    // 空闲期间由控制消息读取线程回复确认和Ping，并发现服务器关闭连接
+    startControlReader();
+    RTMP_LOG_INFO(*this, "备用连接就绪: " + getStatistics().remote_address +
+                  (stage == STARTUP_CREATE_STREAM ? " (已完成createStream)" : " (已完成connect)"));
+    return true;
+}
+
+bool RTMPClient::failoverToStandby() {
+    std::unique_ptr<RTMPClient> standby;
+    {
+        std::unique_lock<std::mutex> lock(standby_mutex_);
+        // 正在发送的Ping结束后才能接管备用会话的socket
+        standby_cv_.wait(lock, [this] { return !standby_heartbeat_busy_; });
+        if (standby_ && standby_->control_reader_running_) {
+            standby = std::move(standby_);
+            // 切换后原主服务器作为新的备用
+            standby_url_ = session_url_;
+            standby_taken_ = true;
+        }
+    }
+    if (!standby) {
+        RTMP_LOG_ERROR(*this, "没有就绪的备用连接，无法切换");
+        return false;
+    }
+    standby_cv_.notify_all();
+    RTMP_LOG_WARN(*this, "主连接故障，切换到备用连接: " + standby->session_url_);
+    
+    // 两个会话的读取线程都停止后才能转移socket和入站状态
+    stopControlReader();
+    standby->stopControlReader();
+    {
+        // 其他线程(心跳)可能正在通过ring发送，关闭ring与关闭socket一样持有send_mutex_
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        io_uring_.close();
+        abortSocket();
+        adoptSession(*standby);
+    }
+    standby.reset();
+    zerocopy_.reset();
+    
+    setState(STATE_CONNECTED);
+    if (!publishAdoptedSession()) {
+        RTMP_LOG_ERROR(*this, "备用连接publish失败: " + getLastError());
+        return false;
+    }
+    setState(STATE_PUBLISHING);
+    beginPublishing();
+    return true;
+}
+
+void RTMPClient::adoptSession(RTMPClient& standby) {
+    socket_fd_ = standby.socket_fd_;
+    standby.socket_fd_ = -1;
+    server_host_ = standby.server_host_;
+    server_port_ = standby.server_port_;
+    app_name_ = standby.app_name_;
+    stream_key_ = standby.stream_key_;
+    session_url_ = standby.session_url_;
+    socket_cork_ = standby.socket_cork_;
+    
+    in_chunk_size_ = standby.in_chunk_size_;
+    out_chunk_size_ = standby.out_chunk_size_;
+    bytes_read_ = standby.bytes_read_;
+    bytes_read_last_ack_ = standby.bytes_read_last_ack_;
+    window_ack_size_ = standby.window_ack_size_;
+    connect_succeeded_ = standby.connect_succeeded_;
+    stream_created_ = standby.stream_created_;
+    publish_started_ = standby.publish_started_;
+    stream_id_ = standby.stream_id_;
+    pipelined_stream_id_ = standby.pipelined_stream_id_;
+    
+    // 备用会话读取线程留下的未解析数据和块流状态一并接管
+    in_chunk_streams_.swap(standby.in_chunk_streams_);
+    inbound_buffer_.swap(standby.inbound_buffer_);
+    inbound_offset_ = standby.inbound_offset_;
+    inbound_end_ = standby.inbound_end_;
+    out_chunk_streams_.swap(standby.out_chunk_streams_);
+    amf3_string_table_.swap(standby.amf3_string_table_);
+    amf3_object_table_.swap(standby.amf3_object_table_);
+    amf3_trait_table_.swap(standby.amf3_trait_table_);
+    
+    RTMPStatistics connection = standby.getStatistics();
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    statistics_.remote_address = connection.remote_address;
+    statistics_.connect_attempts = connection.connect_attempts;
+    statistics_.dns_ms = connection.dns_ms;
+    statistics_.dns_cached = connection.dns_cached;
+    statistics_.connect_ms = connection.connect_ms;
+    statistics_.socket_tuning = connection.socket_tuning;
+}
+
+bool RTMPClient::publishAdoptedSession() {
+    publish_started_ = false;
+    if (stream_created_) {
+        return sendPublish();
+    }
+    if (!config_.pipelined_startup) {
+        return sendCreateStream() && sendPublish();
+    }
+    // createStream和publish一起发出，省去一个往返
+    RTMPSocketTuning::setCork(socket_fd_, true);
+    bool sent = sendPipelinedCommands();
+    RTMPSocketTuning::setCork(socket_fd_, false);
+    return sent &&
+           receiveResponse(stream_created_) &&
+           checkPipelinedPublish() &&
+           receiveResponse(publish_started_);
+}
+
+bool RTMPClient::recoverSession(bool use_queue) {
+    auto detected = std::chrono::steady_clock::now();
+    RTMP_LOG_WARN(*this, "推流连接中断: " + getLastError());
+    if (use_queue) {
+        stopSendQueue(false);
+    }
+    
+    // 恢复期间socket和块流状态被替换，心跳暂停到GOP补发完成
+    pauseHeartbeat(true);
+    bool failover = !config_.backup_url.empty() && failoverToStandby();
+    if ((!failover && !reconnectSession()) ||
+        (use_queue && !startSendQueue()) || !resendGopCache(use_queue)) {
+        pauseHeartbeat(false);
+        return false;
+    }
+    pauseHeartbeat(false);
+    
+    uint32_t elapsed_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - detected).count());
+    {
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        if (failover) {
+            statistics_.failovers++;
+            statistics_.failover_ms = elapsed_ms;
+        } else {
+            statistics_.reconnects++;
+            statistics_.disconnected_ms += elapsed_ms;
+        }
+    }
+    RTMP_LOG_WARN_F(*this, "%s, 耗时%ums", failover ? "已切换到备用连接" : "已重新连接", elapsed_ms);
+    return true;
+}
+
+bool RTMPClient::reconnectSession() {
+    if (config_.reconnect_max_attempts == 0) {
+        return false;
+    }
+    
+    setState(STATE_CONNECTING);
+    stopControlReader();
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        io_uring_.close();
+        abortSocket();
+    }
+    zerocopy_.reset();
+    
+    // 上次重连后稳定推流足够久才重新开始退避；服务器接受发布后很快又断开时，
+    // 退避时间和已用次数接着累计，不会以最短间隔无限重连
+    if (reconnect_attempts_used_ == 0 ||
+        std::chrono::steady_clock::now() - reconnected_at_ >= std::chrono::milliseconds(config_.reconnect_stable_ms)) {
+        reconnect_backoff_ms_ = std::max<uint32_t>(config_.reconnect_initial_delay_ms, 1);
+        reconnect_attempts_used_ = 0;
+    }
+    
+    std::string url = session_url_;
+    std::mt19937 rng(std::random_device{}());
+    while (reconnect_attempts_used_ < config_.reconnect_max_attempts) {
+        uint32_t attempt = ++reconnect_attempts_used_;
+        // 在退避时间的一半到全部之间随机等待，避免同一故障下的大量推流端同时重连
+        uint32_t backoff = reconnect_backoff_ms_;
+        uint32_t delay = backoff / 2 + rng() % (backoff - backoff / 2 + 1);
+        RTMP_LOG_INFO_F(*this, "%ums后第%u/%u次重连: %s", delay, attempt, config_.reconnect_max_attempts, url.c_str());
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        {
+            std::lock_guard<std::mutex> lock(statistics_mutex_);
+            statistics_.reconnect_attempts++;
+        }
+        reconnect_backoff_ms_ = static_cast<uint32_t>(std::min<uint64_t>(
+            static_cast<uint64_t>(backoff) * 2, std::max<uint32_t>(config_.reconnect_max_delay_ms, 1)));
+        
+        if (establishSession(url, STARTUP_PUBLISH)) {
+            setState(STATE_PUBLISHING);
+            beginPublishing();
+            reconnected_at_ = std::chrono::steady_clock::now();
+            return true;
+        }
+    }
+    
+    setError("Failed to reconnect after " + std::to_string(reconnect_attempts_used_) + " attempts");
+    return false;
+}
+
+void RTMPClient::abortSocket() {
+    if (socket_fd_ < 0) {
+        return;
+    }
+    // 故障连接直接复位：正常关闭时内核会继续持有未发出的数据，其中可能有零拷贝发送引用的缓冲区
+    struct linger abort_linger;
+    abort_linger.l_onoff = 1;
+    abort_linger.l_linger = 0;
+    setsockopt(socket_fd_, SOL_SOCKET, SO_LINGER, &abort_linger, sizeof(abort_linger));
+    close(socket_fd_);
+    socket_fd_ = -1;
+}
+
+bool RTMPClient::resendGopCache(bool use_queue) {
+    // 新连接上的播放端需要序列头和完整GOP才能立即解码
+    std::vector<FLVTagView> tags;
+    gop_cache_.snapshot(tags);
+    RTMP_LOG_INFO_F(*this, "补发元数据、序列头和当前GOP: %zu个标签", tags.size());
+    for (size_t i = 0; i < tags.size(); i += WRITER_BATCH_MAX) {
+        size_t count = std::min(WRITER_BATCH_MAX, tags.size() - i);
+        if (use_queue) {
+            for (size_t j = i; j < i + count; ++j) {
+                if (!enqueueFLVTag(tags[j], false)) {
+                    return false;
+                }
+            }
+        } else if (!sendFLVTags(tags.data() + i, count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 发送队列
+bool RTMPClient::startSendQueue() {
+    if (writer_running_) {
+        return true;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        send_queue_.clear();
+        writer_draining_ = false;
+        drop_until_keyframe_ = false;
+    }
+    writer_failed_ = false;
+    writer_running_ = true;
+    writer_thread_ = std::thread(&RTMPClient::writerThreadFunc, this);
+    RTMP_LOG_INFO(*this, "Writer thread started, max queue size: " + std::to_string(config_.max_queue_size));
+    return true;
+}
+
+bool RTMPClient::stopSendQueue(bool drain) {
+    if (!writer_thread_.joinable()) {
+        return !writer_failed_;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        writer_draining_ = true;
+        if (!drain) {
+            writer_running_ = false;
+        }
+    }
+    queue_not_empty_.notify_all();
+    queue_not_full_.notify_all();
+    
+    writer_thread_.join();
+    writer_running_ = false;
+    
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        send_queue_.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        statistics_.queue_depth = 0;
+    }
+    
+    RTMP_LOG_INFO(*this, "Writer thread stopped");
+    return !writer_failed_;
+}
+
+bool RTMPClient::enqueueFLVTag(const FLVTagView& tag, bool droppable, const FLVSourcePosition& resume) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    
+    if (!writer_running_ || writer_failed_) {
+        return false;
+    }
+    
+    FrameDropClass frame_class = classifyFLVTag(tag);
+    
+    if (config_.enable_frame_dropping || !droppable) {
+        // 积压时按优先级丢弃视频帧；其余帧在队列满时阻塞等待，保证音频连续。
+        // 不可丢弃的帧(快速启动的突发部分)同样阻塞等待。写线程一个写超时内没有腾出空间时
+        // 视为发送停滞，推送失败
+        if (droppable && shouldDropFrame(frame_class, send_queue_.size())) {
+            bool congested = congestion_dropping_ && congestion_.level() != CONGESTION_NONE;
+            lock.unlock();
+            std::lock_guard<std::mutex> stats_lock(statistics_mutex_);
+            statistics_.dropped_frames++;
+            if (congested) {
+                statistics_.congestion_dropped_frames++;
+            }
+            if (frame_class == FRAME_CLASS_DISPOSABLE) {
+                statistics_.dropped_disposable_frames++;
+            } else {
+                statistics_.dropped_inter_frames++;
+            }
+            return true;
+        }
+        
+        auto timeout = std::chrono::milliseconds(config_.write_timeout_ms);
+        bool ready = queue_not_full_.wait_for(lock, timeout, [this] {
+            return send_queue_.size() < config_.max_queue_size || !writer_running_ || writer_failed_;
+        });
+        
+        if (!writer_running_ || writer_failed_) {
+            return false;
+        }
+        if (!ready) {
+            lock.unlock();
+            RTMP_LOG_ERROR_F(*this, "发送队列停滞: %ums内没有空位", config_.write_timeout_ms);
+            return false;
+        }
+    } else if (send_queue_.size() >= config_.max_queue_size) {
+        // 未启用丢帧策略时，队列满最多等待一个写超时，仍然满则丢弃该帧
+        auto timeout = std::chrono::milliseconds(config_.write_timeout_ms);
+        queue_not_full_.wait_for(lock, timeout, [this] {
+            return send_queue_.size() < config_.max_queue_size || !writer_running_ || writer_failed_;
+        });
+        
+        if (!writer_running_ || writer_failed_) {
+            return false;
+        }
+        
+        if (send_queue_.size() >= config_.max_queue_size) {
+            lock.unlock();
+            std::lock_guard<std::mutex> stats_lock(statistics_mutex_);
+            statistics_.dropped_frames++;
+            return true;
+        }
+    }
+    
+    QueuedTag queued;
+    queued.tag = tag;
+    queued.resume = resume;
+    send_queue_.push_back(queued);
+    uint32_t depth = static_cast<uint32_t>(send_queue_.size());
+    lock.unlock();
+    queue_not_empty_.notify_one();
+    
+    std::lock_guard<std::mutex> stats_lock(statistics_mutex_);
+    statistics_.queue_depth = depth;
+    if (depth > statistics_.queue_high_water) {
+        statistics_.queue_high_water = depth;
+    }
+    return true;
+}
+
+bool RTMPClient::shouldDropFrame(FrameDropClass frame_class, size_t queue_depth) {
+    // 调用者持有queue_mutex_
+    if (frame_class == FRAME_CLASS_KEY) {
+        // 新的GOP开始，参考链恢复
+        drop_until_keyframe_ = false;
+        return false;
+    }
+    
+    if (frame_class != FRAME_CLASS_INTER && frame_class != FRAME_CLASS_DISPOSABLE) {
+        return false;
+    }
+    
+    if (drop_until_keyframe_) {
+        return true;
+    }
+    
+    size_t inter_level = static_cast<size_t>(config_.max_queue_size) * config_.drop_inter_watermark / 100;
+    size_t disposable_level = static_cast<size_t>(config_.max_queue_size) * config_.drop_disposable_watermark / 100;
+    
+    // 内核发送队列积压的媒体时长与应用队列深度一样触发降级
+    CongestionLevel congestion = congestion_dropping_ ? congestion_.level() : CONGESTION_NONE;
+    
+    // 丢弃P帧后后续帧无法解码，一直丢到下一个关键帧
+    if (queue_depth >= inter_level || queue_depth >= config_.max_queue_size) {
+        drop_until_keyframe_ = true;
+        RTMP_LOG_WARN(*this, "Send queue backlog " + std::to_string(queue_depth) +
+                      ", dropping inter frames until next keyframe");
+        return true;
+    }
+    if (congestion >= CONGESTION_DROP_INTER) {
+        drop_until_keyframe_ = true;
+        RTMP_LOG_WARN(*this, "Socket send queue congested, dropping inter frames until next keyframe");
+        return true;
+    }
+    
+    return frame_class == FRAME_CLASS_DISPOSABLE &&
+           (queue_depth >= disposable_level || congestion >= CONGESTION_DROP_DISPOSABLE);
+}
+
+void RTMPClient::waitZeroCopyCompletions(int timeout_ms) {
+    if (socket_fd_ < 0 || zerocopy_.sends() == 0) {
+        return;
+    }
+    if (!zerocopy_.waitAll(socket_fd_, timeout_ms)) {
+        RTMP_LOG_WARN_F(*this, "等待零拷贝发送完成超时, 未完成%u次", zerocopy_.pending());
+    }
+    updateZeroCopyStatistics();
+}
+
+void RTMPClient::updateZeroCopyStatistics() {
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    statistics_.zerocopy_sends = zerocopy_.sends();
+    statistics_.zerocopy_bytes = zerocopy_.bytes();
+    statistics_.zerocopy_completions = zerocopy_.completions();
+    statistics_.zerocopy_copied = zerocopy_.copied();
+    statistics_.zerocopy_fallbacks = zerocopy_.fallbacks();
+    statistics_.zerocopy_pending = zerocopy_.pending();
+}
+
+void RTMPClient::applySocketTuning(int fd, bool log_warnings) {
+    std::string profile = config_.socket_profile.empty() ? "default" : config_.socket_profile;
+    SocketTuning tuning;
+    if (!RTMPSocketTuning::preset(profile, tuning)) {
+        if (log_warnings) {
+            RTMP_LOG_WARN(*this, "未知的socket调优预设: " + profile + "，使用default");
         }
+        profile = "default";
+        RTMPSocketTuning::preset(profile, tuning);
+    }
+    RTMPSocketTuning::overlay(tuning, config_.socket_tuning);
+    
+    AppliedSocketTuning applied;
+    applied.profile = profile;
+    std::vector<std::string> warnings;
+    RTMPSocketTuning::apply(fd, tuning, applied, warnings);
+    socket_cork_ = applied.tcp_cork;
+    if (!log_warnings) {
+        return;
+    }
+    for (const auto& warning : warnings) {
+        RTMP_LOG_WARN(*this, warning);
+    }
+    
+    RTMP_LOG_DEBUG_F(*this, "socket调优 %s: SNDBUF=%d, RCVBUF=%d, NODELAY=%d, NOTSENT_LOWAT=%d, CORK=%d, 拥塞控制=%s",
+                     profile.c_str(), applied.send_buffer_size, applied.recv_buffer_size,
+                     applied.tcp_nodelay ? 1 : 0, applied.tcp_notsent_lowat, applied.tcp_cork ? 1 : 0,
+                     applied.tcp_congestion.c_str());
+    
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    statistics_.socket_tuning = applied;
+}
+
+ResolveOptions RTMPClient::resolveOptions() const {
+    ResolveOptions options;
+    options.default_ttl_s = std::min(config_.dns_cache_ttl_s, config_.dns_max_ttl_s);
+    options.max_ttl_s = config_.dns_max_ttl_s;
+    return options;
+}
+
+bool RTMPClient::startConnectRace(const RTMPResolveRequest& request) {
+    race_started_ = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        statistics_.dns_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            race_started_ - connect_started_).count());
+        statistics_.dns_cached = request.fromCache();
+    }
+    RTMP_LOG_DEBUG_F(*this, "%s解析到%zu个地址%s", server_host_.c_str(), request.addresses().size(),
+                     request.fromCache() ? "(缓存)" : "");
+    
+    // 缓冲区大小要在连接之前设置才能影响窗口扩大因子；各个尝试的选项相同，只报告一次
+    if (!connect_race_.start(request.addresses(), config_.connect_attempt_delay_ms,
+                             [this](int fd, size_t attempt) { applySocketTuning(fd, attempt == 0); })) {
+        setError(connect_race_.lastError());
+        RTMP_LOG_ERROR(*this, "发起TCP连接失败: " + connect_race_.lastError());
+        return false;
+    }
+    return true;
+}
+
+bool RTMPClient::finishConnectRace(RTMPConnectRace::Status status) {
+    // 连接失败的地址在缓存过期前排到后面，之后的会话先尝试其他地址
+    for (const auto& address : connect_race_.failedAddresses()) {
+        RTMPResolver::instance().reportFailure(server_host_, address);
+        RTMP_LOG_DEBUG(*this, "连接失败的地址: " + address.toString());
     }
+    
+    if (status != RTMPConnectRace::RACE_CONNECTED) {
+        connect_race_.cancel();
+        setError("Failed to connect to " + server_host_ + ": " + connect_race_.lastError());
+        RTMP_LOG_ERROR(*this, "TCP连接失败: " + connect_race_.lastError());
+        return false;
+    }
+    
+    socket_fd_ = connect_race_.takeSocket();
+    uint32_t connect_ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - race_started_).count());
+    {
+        std::lock_guard<std::mutex> lock(statistics_mutex_);
+        statistics_.remote_address = connect_race_.winner().toString();
+        statistics_.connect_attempts = static_cast<uint32_t>(connect_race_.attemptsStarted());
+        statistics_.connect_ms = connect_ms;
+    }
+    RTMP_LOG_INFO_F(*this, "TCP连接建立: %s (尝试%zu个地址, %ums)", connect_race_.winner().toString().c_str(),
+                    connect_race_.attemptsStarted(), connect_ms);
+    return true;
+}
+
+void RTMPClient::resetCongestionMonitor() {
+    congestion_sampling_ = config_.congestion_policy == "observe" || config_.congestion_policy == "drop";
+    congestion_dropping_ = config_.congestion_policy == "drop";
+    if (!congestion_sampling_ && config_.congestion_policy != "off") {
+        RTMP_LOG_WARN(*this, "未知的拥塞策略: " + config_.congestion_policy + "，不进行拥塞监测");
+    }
+    
+    congestion_.configure(config_.congestion_sample_ms, config_.congestion_drop_disposable_ms,
+                          config_.congestion_drop_inter_ms);
+    congestion_.reset();
 }
 
+void RTMPClient::sampleCongestion() {
+    // 调用者持有send_mutex_
+    CongestionLevel previous = congestion_.level();
+    if (!congestion_.sampleIfDue(socket_fd_)) {
+        return;
+    }
+    
+    const CongestionSample& sample = congestion_.lastSample();
+    CongestionLevel level = congestion_.level();
+    if (level != previous) {
+        RTMP_LOG_WARN_F(*this, "拥塞等级 %d -> %d: 发送队列%u字节, 积压%ums, RTT=%uus, cwnd=%u",
+                        static_cast<int>(previous), static_cast<int>(level), sample.outq_bytes,
+                        sample.queued_ms, sample.rtt_us, sample.cwnd);
+    }
+    
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    statistics_.tcp_rtt_us = sample.rtt_us;
+    statistics_.tcp_cwnd = sample.cwnd;
+    statistics_.tcp_delivery_rate = sample.delivery_rate;
+    statistics_.tcp_drain_rate = sample.drain_rate;
+    statistics_.tcp_send_queue_bytes = sample.outq_bytes;
+    statistics_.tcp_queued_ms = sample.queued_ms;
+    statistics_.congestion_level = static_cast<uint32_t>(level);
+    statistics_.congestion_level_changes = congestion_.levelChanges();
+}
+
+void RTMPClient::writerThreadFunc() {
+    std::vector<FLVTagView> batch;
+    batch.reserve(WRITER_BATCH_MAX);
+    
+    while (true) {
+        uint32_t depth;
+        FLVSourcePosition resume;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_not_empty_.wait(lock, [this] {
+                return !send_queue_.empty() || writer_draining_ || !writer_running_;
+            });
+            
+            // 非排空停止时立即退出；排空停止时发完剩余帧再退出
+            if (!writer_running_ || send_queue_.empty()) {
+                break;
+            }
+            
+            // 积压的帧一次取出，块合并后一次系统调用发送
+            batch.clear();
+            while (!send_queue_.empty() && batch.size() < WRITER_BATCH_MAX) {
+                batch.push_back(send_queue_.front().tag);
+                if (send_queue_.front().resume.valid) {
+                    resume = send_queue_.front().resume;
+                }
+                send_queue_.pop_front();
+            }
+            depth = static_cast<uint32_t>(send_queue_.size());
+        }
+        queue_not_full_.notify_all();
+        
+        {
+            std::lock_guard<std::mutex> lock(statistics_mutex_);
+            statistics_.queue_depth = depth;
+        }
+        
+        if (!sendFLVTags(batch.data(), batch.size())) {
+            RTMP_LOG_ERROR(*this, "Writer thread failed to send FLV tag");
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                writer_failed_ = true;
+            }
+            queue_not_full_.notify_all();
+            break;
+        }
+        // 恢复点及之前的帧都已发出，可以记入检查点
+        if (resume.valid) {
+            checkpoint_.update(resume);
+        }
+    }
+}
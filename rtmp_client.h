@@ -9,7 +9,20 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <chrono>
+#include <sys/uio.h>
+#include "flv_source.h"
+#include "rtmp_pacer.h"
+#include "rtmp_io_uring.h"
+#include "rtmp_congestion.h"
+#include "rtmp_socket_tuning.h"
+#include "rtmp_zerocopy.h"
+#include "rtmp_resolver.h"
+#include "rtmp_connect_race.h"
+#include "rtmp_gop_cache.h"
+#include "rtmp_checkpoint.h"
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
@@ -33,6 +46,28 @@ enum RTMPMessageType {
     RTMP_MSG_AGGREGATE = 22
 };
 
+// 发送使用的块流ID，不同类型的消息分开以便各自压缩消息头
+enum RTMPChunkStreamID {
+    RTMP_CSID_PROTOCOL = 2,     // 协议控制和用户控制消息
+    RTMP_CSID_COMMAND = 3,      // AMF命令
+    RTMP_CSID_AUDIO = 4,
+    RTMP_CSID_DATA = 5,         // 脚本数据(onMetaData等)
+    RTMP_CSID_VIDEO = 6,
+    RTMP_CSID_AGGREGATE = 7     // 聚合消息(音视频标签混合)
+};
+
+// 启动命令的事务ID，响应按事务ID匹配
+enum RTMPCommandTransaction {
+    RTMP_TXN_CONNECT = 1,
+    RTMP_TXN_CREATE_STREAM = 2,
+    RTMP_TXN_PUBLISH = 3,
+    RTMP_TXN_RELEASE_STREAM = 4,    // 可选，服务器可能不应答或应答_error
+    RTMP_TXN_FC_PUBLISH = 5
+};
+
+// 聚合消息中每个子标签的开销：11字节标签头 + 4字节PreviousTagSize
+static const size_t AGGREGATE_TAG_OVERHEAD = 15;
+
 // FLV标签类型
 enum FLVTagType {
     FLV_TAG_AUDIO = 8,
@@ -40,6 +75,14 @@ enum FLVTagType {
     FLV_TAG_SCRIPT = 18
 };
 
+// 拥塞时的帧丢弃分类，数值越大越优先丢弃
+enum FrameDropClass {
+    FRAME_CLASS_CRITICAL = 0,       // 音频、序列头、脚本数据：永不丢弃
+    FRAME_CLASS_KEY = 1,            // 视频关键帧
+    FRAME_CLASS_INTER = 2,          // 普通帧间预测帧(P帧)
+    FRAME_CLASS_DISPOSABLE = 3      // 可丢弃帧间帧，不被其他帧参考
+};
+
 // FLV标签结构
 struct FLVTag {
     uint8_t type;
@@ -128,15 +171,54 @@ enum ConnectionState {
 
 // 配置结构
 struct RTMPConfig {
-    uint32_t connect_timeout_ms = 5000;
+    uint32_t connect_timeout_ms = 5000;     // 包括名字解析和TCP连接
+    uint32_t connect_attempt_delay_ms = 250;    // 并行连接时发起下一个地址前等待的时间
+    uint32_t dns_cache_ttl_s = 60;          // DNS记录没有TTL时的缓存时长
+    uint32_t dns_max_ttl_s = 300;           // 缓存时长上限，0表示不缓存
     uint32_t read_timeout_ms = 3000;
     uint32_t write_timeout_ms = 3000;
     uint32_t max_retry_count = 3;
     uint32_t retry_interval_ms = 1000;
+    std::string backup_url;             // 热备服务器，非空时推流期间保持一个已完成connect的备用连接
+    bool standby_create_stream = false; // 备用连接预先完成createStream，切换时只需publish
+    uint32_t reconnect_max_attempts = 0;    // 推流中途断开后连续重连的最多次数，0表示不重连
+    uint32_t reconnect_initial_delay_ms = 500;  // 第一次重连前的等待时间，之后每次翻倍
+    uint32_t reconnect_max_delay_ms = 30000;    // 重连等待时间上限
+    uint32_t reconnect_stable_ms = 10000;       // 重连后稳定推流超过该时长，退避和次数才重新计算
     bool enable_heartbeat = true;
     uint32_t heartbeat_interval_ms = 30000;
     bool enable_statistics = true;
-    uint32_t max_queue_size = 1000;
+    uint32_t max_queue_size = 1000;     // 发送队列最多缓存的帧数
+    bool enable_send_queue = true;      // 文件读取/节奏控制与socket写入分离到独立写线程
+    bool enable_frame_dropping = true;  // 队列积压时按GOP结构丢弃视频帧
+    uint32_t drop_disposable_watermark = 50;    // 队列深度达到该百分比时丢弃可丢弃帧
+    uint32_t drop_inter_watermark = 80;         // 达到该百分比时丢弃P帧直到下一个关键帧
+    uint32_t chunk_size = 4096;         // 发送方向的块大小，连接后通过Set Chunk Size通告
+    bool pipelined_startup = false;     // 收到S1后连同C2一次发出全部启动命令，不逐条等待响应
+    bool release_stream = false;        // createStream之前发送releaseStream和FCPublish(FMLE兼容)
+    uint32_t clip_start_ms = 0;         // 从该时间点(相对文件首个标签)之前最近的关键帧开始推送
+    uint32_t clip_end_ms = 0;           // 推送到该时间点为止，0表示推送到文件结尾
+    bool enable_flv_index = true;       // 定位时使用并生成FLV索引旁路文件(<flv>.idx)
+    uint32_t loop_count = 1;            // 文件(或播放列表)的播放次数，0表示无限循环
+    uint32_t pacing_lead_ms = 0;        // 比媒体时间提前发送的时长
+    uint32_t pacing_max_catchup_ms = 1000;  // 停顿后最多以线速追赶的媒体时长，落后更多时重新对齐
+    bool fast_start = false;            // 开头的元数据、序列头和第一个GOP立即发送
+    uint32_t fast_start_lead_ms = 0;    // 第一个GOP之后额外立即发送的媒体时长
+    uint32_t read_ahead_ms = 0;         // 预读线程提前读入页缓存的媒体时长，0表示不启用
+    std::string checkpoint_file;        // 推送进度检查点，非空时定期写入，重启后从中恢复
+    uint32_t checkpoint_interval_ms = 5000;     // 检查点写入间隔
+    bool enable_io_uring = false;       // 阻塞推流路径通过io_uring发送，不可用时回退到sendmsg
+    bool enable_aggregation = false;    // 时间窗口内连续的小音视频标签打包为一条聚合消息(类型22)
+    uint32_t aggregate_window_ms = 50;  // 聚合的时间窗口，也是标签最多提前发送的时长
+    uint32_t aggregate_max_bytes = 16384;   // 单条聚合消息体的最大字节数
+    std::string congestion_policy = "off";  // 拥塞监测：off不采样，observe只统计，drop按积压时长丢帧
+    uint32_t congestion_sample_ms = 100;    // TCP_INFO/SIOCOUTQ采样间隔
+    uint32_t congestion_drop_disposable_ms = 500;   // 内核发送队列积压超过该媒体时长时丢弃可丢弃帧
+    uint32_t congestion_drop_inter_ms = 1500;       // 超过该时长时丢弃P帧直到下一个关键帧
+    std::string socket_profile = "default"; // socket调优预设：default/low-latency/high-throughput/lossy-link
+    SocketTuning socket_tuning;             // 显式设置的选项，覆盖预设中的对应项
+    bool enable_zerocopy = false;           // 大音视频消息通过MSG_ZEROCOPY发送，负载页面直接交给网卡
+    uint32_t zerocopy_threshold = 32768;    // 不小于该字节数的音视频消息走零拷贝，较小的消息仍然拷贝
 };
 
 // 统计信息结构
@@ -148,8 +230,54 @@ struct RTMPStatistics {
     uint64_t audio_frames = 0;
     uint64_t video_frames = 0;
     uint64_t dropped_frames = 0;
+    uint64_t dropped_disposable_frames = 0;     // 其中丢弃的可丢弃帧间帧
+    uint64_t dropped_inter_frames = 0;          // 其中丢弃的P帧
     uint32_t current_bitrate = 0;
     uint32_t avg_bitrate = 0;
+    uint32_t queue_depth = 0;           // 发送队列当前深度(帧)
+    uint32_t queue_high_water = 0;      // 发送队列深度历史最大值
+    uint64_t paced_frames = 0;          // 经过节奏控制的帧数
+    uint64_t pacing_late_frames = 0;    // 晚于计划时刻1ms以上发送的帧数
+    uint32_t pacing_max_late_us = 0;    // 最大发送延迟
+    uint32_t pacing_avg_late_us = 0;    // 平均发送延迟
+    uint64_t pacing_resyncs = 0;        // 停顿或时间戳跳变导致的时间基准重建次数
+    uint32_t read_ahead_buffered_ms = 0;        // 预读线程当前领先发送位置的媒体时长
+    uint64_t read_ahead_low_buffer_events = 0;  // 发送位置追上预读位置的次数
+    uint64_t send_calls = 0;            // 阻塞发送路径的发送系统调用次数(sendmsg或io_uring_enter)
+    uint64_t aggregate_messages = 0;    // 发送的聚合消息数
+    uint64_t aggregated_tags = 0;       // 打包进聚合消息的标签数
+    uint64_t acks_sent = 0;             // 发送的确认消息数
+    uint64_t ping_responses = 0;        // 回复服务器Ping请求的次数
+    uint32_t tcp_rtt_us = 0;            // 最近一次拥塞采样：平滑RTT
+    uint32_t tcp_cwnd = 0;              // 拥塞窗口(报文段)
+    uint64_t tcp_delivery_rate = 0;     // 内核估计的交付速率(字节/秒)
+    uint64_t tcp_drain_rate = 0;        // 发送队列的平滑排空速率(字节/秒)
+    uint32_t tcp_send_queue_bytes = 0;  // 内核发送队列中的字节数(SIOCOUTQ)
+    uint32_t tcp_queued_ms = 0;         // 按当前速率估算的发送队列积压媒体时长
+    uint32_t congestion_level = 0;      // 当前拥塞等级(CongestionLevel)
+    uint64_t congestion_level_changes = 0;  // 拥塞等级变化次数
+    uint64_t congestion_dropped_frames = 0; // 拥塞等级非零时丢弃的帧数
+    AppliedSocketTuning socket_tuning;  // 连接时实际生效的socket选项
+    uint64_t zerocopy_sends = 0;        // 带MSG_ZEROCOPY的发送调用数
+    uint64_t zerocopy_bytes = 0;        // 其中写入的字节数
+    uint64_t zerocopy_completions = 0;  // 收到的完成通知(按发送调用计)
+    uint64_t zerocopy_copied = 0;       // 其中内核回退为拷贝的发送数
+    uint64_t zerocopy_fallbacks = 0;    // 通知内存不足(ENOBUFS)改为普通发送的次数
+    uint32_t zerocopy_pending = 0;      // 尚未完成的零拷贝发送数
+    std::string remote_address;         // 实际连接的服务器地址
+    uint32_t connect_attempts = 0;      // 并行连接发起的尝试数
+    uint32_t dns_ms = 0;                // 名字解析耗时
+    bool dns_cached = false;            // 解析结果来自缓存
+    uint32_t connect_ms = 0;            // 解析完成到TCP连接建立的耗时
+    uint32_t startup_ms = 0;            // 开始解析到发布开始(NetStream.Publish.Start)的耗时
+    uint32_t failovers = 0;             // 切换到备用连接的次数
+    uint32_t failover_ms = 0;           // 最近一次切换从发现故障到补发完成的耗时
+    uint32_t standby_connects = 0;      // 建立备用连接的次数
+    uint32_t reconnects = 0;            // 推流中途重连成功的次数
+    uint32_t reconnect_attempts = 0;    // 重连尝试次数(含失败)
+    uint64_t disconnected_ms = 0;       // 重连期间没有发布会话的累计时长
+    uint64_t checkpoint_writes = 0;     // 写入检查点的次数
+    bool checkpoint_resumed = false;    // 本次推送从检查点恢复
     std::chrono::steady_clock::time_point start_time;
     std::chrono::steady_clock::time_point last_update;
 };
@@ -172,6 +300,22 @@ public:
     // 推送FLV文件
     bool pushFLVFile(const std::string& flv_file_path);
     
+    // 推送FLV文件片段[start_ms, end_ms)，时间相对文件首个标签，end_ms为0表示到文件结尾。
+    // 从start_ms之前最近的关键帧开始，先发送元数据和序列头，时间戳从0开始重新计算
+    bool pushFLVFile(const std::string& flv_file_path, uint32_t start_ms, uint32_t end_ms);
+    
+    // 在同一个发布会话中依次推送多个文件(按loop_count循环)，时间戳连续递增。
+    // pushFLVFile的参数是播放列表文件(.m3u/.m3u8/.txt/.lst)时同样按列表推送
+    bool pushPlaylist(const std::vector<std::string>& flv_files);
+    
+    // 异步发送队列：生产者入队，写线程独占socket发送
+    // 队列只保存标签视图，负载在出队发送(或stopSendQueue返回)之前必须保持有效
+    bool startSendQueue();
+    bool stopSendQueue(bool drain = true);
+    // resume有效时表示该标签是恢复点，写线程发出后记入检查点
+    bool enqueueFLVTag(const FLVTagView& tag, bool droppable = true,
+                       const FLVSourcePosition& resume = FLVSourcePosition());
+    
     // 设置推流参数
     void setStreamKey(const std::string& stream_key);
     void setChunkSize(uint32_t chunk_size);
@@ -181,12 +325,22 @@ public:
     ConnectionState getConnectionState() const;
     bool isConnected() const;
     RTMPStatistics getStatistics() const;
+    std::string getLastError() const;
     
     // 心跳和保活
     bool sendHeartbeat();
     void startHeartbeatThread();
     void stopHeartbeatThread();
     
+    // 事件驱动模式：非阻塞socket，由RTMPEventLoop在事件线程上驱动，不创建任何线程
+    bool startAsync(const std::string& url, const std::string& flv_file_path);
+    bool onSocketEvent(uint32_t events);    // 返回false表示会话已结束
+    bool onTimer();                         // 返回false表示会话已结束
+    std::chrono::steady_clock::time_point nextTimerDeadline() const;
+    int socketFd() const;
+    int pollFd() const;                     // 事件循环应等待的fd，解析和连接阶段不是socket本身
+    bool asyncSucceeded() const;
+    
 private:
     // 网络相关
     int socket_fd_;
@@ -195,23 +349,169 @@ private:
     std::string app_name_;
     std::string stream_key_;
     
-    // RTMP协议相关
-    uint32_t chunk_size_;
+    // RTMP协议相关（收发两个方向的块大小相互独立）
+    uint32_t in_chunk_size_;
+    uint32_t out_chunk_size_;
     uint32_t bytes_read_;
     uint32_t bytes_read_last_ack_;
     uint32_t window_ack_size_;
     
+    // 命令响应结果
+    bool connect_succeeded_;
+    bool stream_created_;
+    bool publish_started_;
+    uint32_t stream_id_;            // createStream返回的消息流ID
+    uint32_t pipelined_stream_id_;  // 流水线启动时publish使用的预测流ID，0表示命令逐条发送
+    std::string session_url_;       // 当前连接的URL
+    
+    // 启动命令执行到哪一步，备用连接停在connect或createStream之后
+    enum StartupStage {
+        STARTUP_CONNECT,
+        STARTUP_CREATE_STREAM,
+        STARTUP_PUBLISH
+    };
+    
+    // 入站块流状态，用于拼接跨多个块和多次读取的消息
+    struct InboundChunkStream {
+        bool initialized = false;
+        bool extended = false;          // 最近的fmt 0/1/2头是否带扩展时间戳
+        uint32_t timestamp_delta = 0;
+        RTMPMessageHeader header;
+        std::vector<uint8_t> payload;   // 正在拼接的消息
+    };
+    std::map<uint32_t, InboundChunkStream> in_chunk_streams_;
+    // 接收缓冲区：[inbound_offset_, inbound_end_)为未解析的数据，
+    // 尾部空间不足时把剩余数据移到开头，缓冲区本身在连接之间复用
+    std::vector<uint8_t> inbound_buffer_;
+    size_t inbound_offset_;
+    size_t inbound_end_;
+    std::vector<uint8_t> inbound_message_;  // 交给处理函数的完整消息，与块流的拼接缓冲区交换复用
+    
+    // 事件驱动模式状态
+    enum AsyncPhase {
+        ASYNC_IDLE = 0,
+        ASYNC_RESOLVING,
+        ASYNC_TCP_CONNECTING,
+        ASYNC_HANDSHAKING,
+        ASYNC_CONNECT_SENT,
+        ASYNC_CREATE_STREAM_SENT,
+        ASYNC_PUBLISH_SENT,
+        ASYNC_PUBLISHING,
+        ASYNC_DRAINING,             // 文件已读完，等待输出缓冲区发送完毕
+        ASYNC_DONE,
+        ASYNC_FAILED
+    };
+    bool async_mode_;
+    AsyncPhase async_phase_;
+    std::vector<uint8_t> async_output_;     // 非阻塞写未能立即发出的数据
+    size_t async_output_offset_;
+    FLVSource async_source_;
+    FLVTagView async_tag_;
+    bool async_tag_pending_;                // async_tag_已读取但还未到发送时间
+    std::vector<FLVTagView> async_group_;   // 与async_tag_一起发送的聚合窗口内的标签
+    RTMPPacer async_pacer_;
+    std::chrono::steady_clock::time_point async_tag_due_;  // async_tag_的计划发送时刻
+    std::chrono::steady_clock::time_point async_startup_deadline_;
+    size_t async_s2_remaining_;             // 流水线启动时尚未丢弃的S2字节数
+    std::chrono::steady_clock::time_point async_next_heartbeat_;
+    
     // 连接状态和配置
     ConnectionState connection_state_;
     RTMPConfig config_;
     RTMPStatistics statistics_;
+    uint64_t pacing_total_late_us_;
     std::string last_error_;
+    std::string log_tag_;
     
     // 心跳和线程管理
     std::thread heartbeat_thread_;
     std::atomic<bool> heartbeat_running_;
+    bool heartbeat_paused_;         // 连接恢复期间暂停，受heartbeat_mutex_保护
+    std::mutex heartbeat_mutex_;
+    std::condition_variable heartbeat_cv_;
+    std::thread control_reader_thread_;
+    std::atomic<bool> control_reader_running_;
+    int control_wake_fd_;           // eventfd，停止时唤醒读取线程，不必等到轮询超时
     std::mutex state_mutex_;
     std::mutex statistics_mutex_;
+    std::mutex send_mutex_;
+    
+    // 发送队列和写线程
+    struct QueuedTag {
+        FLVTagView tag;
+        FLVSourcePosition resume;       // 标签是恢复点时有效
+    };
+    std::deque<QueuedTag> send_queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_not_empty_;
+    std::condition_variable queue_not_full_;
+    std::thread writer_thread_;
+    std::atomic<bool> writer_running_;
+    std::atomic<bool> writer_failed_;
+    bool writer_draining_;
+    bool drop_until_keyframe_;      // 已丢弃P帧，参考链断开，直到下一个关键帧
+    
+    // 块写入器状态（受send_mutex_保护）
+    struct ChunkSegment {
+        size_t header_offset;       // 块头在header arena中的偏移
+        size_t header_length;
+        const uint8_t* payload;     // 指向调用者的负载数据，flush前必须有效
+        size_t payload_length;
+        bool zerocopy;              // 负载在零拷贝发送完成前保持有效，可以用MSG_ZEROCOPY发送
+    };
+    std::vector<uint8_t> chunk_header_arena_;
+    std::vector<ChunkSegment> chunk_segments_;
+    std::vector<struct iovec> chunk_iovecs_;
+    uint32_t flush_send_calls_;     // 本次flush的发送系统调用次数
+    
+    // 聚合消息体，全部写完后才被块引用，flush前不再增长
+    struct AggregateRun {
+        size_t first_tag;
+        size_t tag_count;
+        size_t body_offset;
+        size_t body_length;
+    };
+    std::vector<uint8_t> aggregate_arena_;
+    std::vector<AggregateRun> aggregate_runs_;
+    RTMPIoUring io_uring_;          // 启用io_uring时由connect()建立，disconnect()关闭
+    RTMPCongestionMonitor congestion_;  // 在send_mutex_内采样
+    bool congestion_sampling_;
+    bool congestion_dropping_;
+    bool socket_cork_;              // 一次发送多个标签时用TCP_CORK合并
+    RTMPZeroCopy zerocopy_;         // 零拷贝发送的完成跟踪，控制消息读取线程也会读取完成通知
+    RTMPConnectRace connect_race_;  // 对解析出的各个地址并行连接
+    std::shared_ptr<RTMPResolveRequest> async_resolve_;     // 事件驱动模式的解析请求，断开时释放
+    std::chrono::steady_clock::time_point connect_started_; // 开始解析的时刻
+    std::chrono::steady_clock::time_point race_started_;    // 开始TCP连接的时刻
+    
+    // 热备连接：后台线程保持一个已完成connect的备用会话，主连接失败时接管其socket和协议状态
+    std::unique_ptr<RTMPClient> standby_;   // 就绪的备用会话，受standby_mutex_保护
+    std::string standby_url_;
+    bool standby_running_;
+    bool standby_taken_;                    // 备用会话已被取走，备用线程应立即重建
+    bool standby_heartbeat_busy_;           // 备用线程正在锁外向standby_发送Ping
+    std::mutex standby_mutex_;
+    std::condition_variable standby_cv_;
+    std::thread standby_thread_;
+    RTMPGopCache gop_cache_;                // 切换或重连后补发的序列头和当前GOP
+    
+    // 重连退避在连续的中断之间延续，重连后稳定推流reconnect_stable_ms才重置
+    uint32_t reconnect_backoff_ms_;
+    uint32_t reconnect_attempts_used_;
+    std::chrono::steady_clock::time_point reconnected_at_;
+    RTMPCheckpointWriter checkpoint_;       // 推送进度检查点，写线程发出恢复点后更新
+    
+    // 每个块流上一条消息的头部，用于选择最小的fmt 1/2/3头
+    struct ChunkStreamState {
+        bool active = false;
+        bool has_delta = false;     // 上一条消息是否以时间戳增量(fmt 1/2/3)发送
+        uint32_t timestamp = 0;
+        uint32_t timestamp_delta = 0;
+        uint32_t message_length = 0;
+        uint8_t message_type = 0;
+        uint32_t message_stream_id = 0;
+    };
+    std::vector<ChunkStreamState> out_chunk_streams_;
     
     // AMF引用表
     std::vector<std::string> amf3_string_table_;
@@ -222,41 +522,83 @@ private:
     bool parseURL(const std::string& url);
     bool connectSocket();
     bool handshake();
+    bool establishSession(const std::string& url, StartupStage stage);
+    void beginPublishing();
+    bool pipelinedStartup(StartupStage stage);
     bool sendConnect();
     bool sendCreateStream();
     bool sendPublish();
+    void generateC0C1(std::vector<uint8_t>& c0c1);
+    bool sendConnectCommand();
+    bool sendCreateStreamCommand();
+    bool sendPublishCommand();
+    bool sendReleaseStreamCommands();
+    bool sendStreamNameCommand(const std::string& command, double transaction_id);
+    bool sendPipelinedCommands(StartupStage stage = STARTUP_PUBLISH);
+    bool checkPipelinedPublish();
+    void recordStartup();
     
     // FLV文件处理
-    bool readFLVHeader(std::ifstream& file);
-    bool readFLVTag(std::ifstream& file, FLVTag& tag);
-    bool sendFLVTag(const FLVTag& tag);
+    bool openFLVSource(FLVSource& source, const std::vector<std::string>& files,
+                       uint32_t start_ms, uint32_t end_ms, std::string& error);
+    bool pushFLVSource(FLVSource& source);
+    bool sendFLVTag(const FLVTagView& tag);
+    bool sendFLVTags(const FLVTagView* tags, size_t count);
+    bool isAggregatable(const FLVTagView& tag) const;
+    bool fitsAggregate(const FLVTagView& first, size_t body_size, const FLVTagView& tag) const;
+    void recordPacing(int64_t late_us, uint64_t resyncs);
+    void recordReadAhead(const FLVSource& source);
+    FrameDropClass classifyFLVTag(const FLVTagView& tag) const;
+    bool shouldDropFrame(FrameDropClass frame_class, size_t queue_depth);
+    void resetCongestionMonitor();
+    void applySocketTuning(int fd, bool log_warnings);
+    ResolveOptions resolveOptions() const;
+    bool startConnectRace(const RTMPResolveRequest& request);
+    bool finishConnectRace(RTMPConnectRace::Status status);
+    void sampleCongestion();
     
     // RTMP消息发送
     bool sendRTMPMessage(uint8_t msg_type, uint32_t stream_id, 
                         const std::vector<uint8_t>& data, uint32_t timestamp = 0);
+    bool sendRTMPMessage(uint8_t msg_type, uint32_t stream_id,
+                        const uint8_t* data, size_t size, uint32_t timestamp = 0);
     bool sendChunk(uint8_t chunk_stream_id, uint8_t msg_type, 
-                   uint32_t stream_id, const std::vector<uint8_t>& data, 
+                   uint32_t stream_id, const uint8_t* data, size_t size,
                    uint32_t timestamp = 0);
     
+    // 分散/聚集块写入：头部写入header arena，负载直接引用调用者内存
+    void queueChunks(uint8_t chunk_stream_id, uint8_t msg_type,
+                     uint32_t stream_id, const uint8_t* data, size_t size,
+                     uint32_t timestamp, bool zerocopy = false);
+    bool flushChunks();
+    bool writeIovecs(struct iovec* iov, size_t count, bool zerocopy = false);
+    void waitZeroCopyCompletions(int timeout_ms);
+    void updateZeroCopyStatistics();
+    void writeChunkBasicHeader(uint8_t fmt, uint8_t chunk_stream_id);
+    uint8_t chunkStreamForMessage(uint8_t msg_type) const;
+    void resetChunkStreams();
+    
     // 数据接收和消息解析
     bool receiveData(std::vector<uint8_t>& buffer, size_t size);
-    bool receiveResponse();
-    bool parseRTMPMessage(const uint8_t*& data, size_t& remaining);
-    bool parseMessageHeader(const uint8_t*& data, size_t& remaining, uint8_t fmt, RTMPMessageHeader& header);
+    bool receiveResponse(const bool& completed);
+    ssize_t recvInbound(int flags);
+    bool demuxInbound();
+    void resetInboundState();
     bool handleRTMPMessage(const RTMPMessageHeader& header, const std::vector<uint8_t>& data);
     
     // RTMP消息处理
     bool handleChunkSize(const std::vector<uint8_t>& data);
-    bool sendChunkSizeAck();
+    bool handleAbort(const std::vector<uint8_t>& data);
+    bool sendSetChunkSize(uint32_t chunk_size);
     bool handleAcknowledgement(const std::vector<uint8_t>& data);
     bool handleWindowAckSize(const std::vector<uint8_t>& data);
     bool handleSetPeerBandwidth(const std::vector<uint8_t>& data);
     bool handleUserControl(const std::vector<uint8_t>& data);
-    bool handleAMF0Command(const std::vector<uint8_t>& data);
+    bool handleAMF0Command(const std::vector<uint8_t>& data, uint32_t message_stream_id);
     bool handleAMF3Command(const std::vector<uint8_t>& data);
     bool handleCommandResult(double transaction_id, const uint8_t* data, size_t remaining);
     bool handleCommandError(double transaction_id, const uint8_t* data, size_t remaining);
-    bool handleOnStatus(const uint8_t* data, size_t remaining);
+    bool handleOnStatus(const uint8_t* data, size_t remaining, uint32_t message_stream_id);
     
     // 工具方法
     void writeUint32BE(std::vector<uint8_t>& buffer, uint32_t value);
@@ -316,7 +658,7 @@ private:
     bool checkConnection();
     
     // 统计和监控
-    void updateStatistics(size_t bytes_sent, size_t bytes_received);
+    void updateStatistics(size_t bytes_sent, size_t bytes_received, uint32_t send_calls = 0);
     void updateFrameCount(uint8_t frame_type);
     
     // 超时和重试
@@ -325,6 +667,44 @@ private:
     
     // 心跳线程函数
     void heartbeatThreadFunc();
+    // 暂停时心跳线程不发送；返回时正在进行的发送已经结束
+    void pauseHeartbeat(bool paused);
+    
+    // 控制消息读取线程：阻塞推流期间读取并处理服务器消息，回复确认和Ping
+    void startControlReader();
+    void stopControlReader();
+    void controlReaderThreadFunc();
+    bool sendAcknowledgement(uint32_t sequence_number);
+    bool sendPingResponse(uint32_t timestamp);
+    
+    // 写线程函数
+    void writerThreadFunc();
+    
+    // 热备连接和故障切换
+    void startStandby(const std::string& url);
+    void stopStandby();
+    void standbyThreadFunc();
+    bool prepareStandby(const std::string& url);
+    bool failoverToStandby();
+    void adoptSession(RTMPClient& standby);
+    bool publishAdoptedSession();
+    bool resendGopCache(bool use_queue);
+    
+    // 推流中途的连接恢复：优先切换到备用连接，否则按指数退避重连同一服务器
+    bool recoverSession(bool use_queue);
+    bool reconnectSession();
+    void abortSocket();
+    
+    // 事件驱动模式内部方法
+    bool asyncStartConnect();
+    bool asyncStepConnect();
+    bool asyncWrite(const struct iovec* iov, size_t count);
+    bool asyncFlushOutput();
+    bool asyncReadInput();
+    bool asyncAdvance();
+    bool asyncPumpMedia();
+    void asyncScheduleTag(std::chrono::steady_clock::time_point now);
+    bool asyncFail(const std::string& error);
 
 public:
     // 内部日志方法（不直接调用）
@@ -336,6 +716,7 @@ public:
     // 日志控制方法
     bool initializeLogger();
     void setLogLevel(const std::string& level);
+    void setLogTag(const std::string& tag);     // 日志前缀，多路推流时区分会话
     void flushLogs();
     void shutdownLogger();
 };
@@ -0,0 +1,480 @@
+#include "rtmp_client.h"
+#include "rtmp_logger.h"
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstring>
+
+// 事件驱动模式下输出缓冲区积压超过该值时暂停读取媒体数据
+static const size_t ASYNC_OUTPUT_HIGH_WATER = 256 * 1024;
+
+// 握手阶段服务器应答S0+S1+S2的长度
+static const size_t HANDSHAKE_RESPONSE_SIZE = 1 + 1536 + 1536;
+
+bool RTMPClient::startAsync(const std::string& url, const std::string& flv_file_path) {
+    RTMP_LOG_DEBUG(*this, "异步模式连接到RTMP服务器: " + url);
+
+    if (!parseURL(url)) {
+        return false;
+    }
+
+    // 事件驱动模式不写入检查点，读取它只会在每次重启时重放过期的进度
+    if (!config_.checkpoint_file.empty()) {
+        RTMP_LOG_WARN(*this, "事件驱动模式不支持checkpoint_file，已忽略");
+        config_.checkpoint_file.clear();
+    }
+
+    std::string error;
+    if (!openFLVSource(async_source_, std::vector<std::string>(1, flv_file_path),
+                       config_.clip_start_ms, config_.clip_end_ms, error)) {
+        setError(error);
+        return false;
+    }
+
+    // 新连接的协议状态
+    in_chunk_size_ = 128;
+    out_chunk_size_ = 128;
+    resetChunkStreams();
+    resetInboundState();
+    connect_succeeded_ = false;
+    stream_created_ = false;
+    publish_started_ = false;
+    stream_id_ = 1;
+    pipelined_stream_id_ = 0;
+    async_s2_remaining_ = 0;
+
+    async_mode_ = true;
+    async_phase_ = ASYNC_RESOLVING;
+    async_output_.clear();
+    async_output_offset_ = 0;
+    async_tag_pending_ = false;
+    async_pacer_.configure(config_.pacing_lead_ms, config_.pacing_max_catchup_ms);
+    async_pacer_.setFastStart(config_.fast_start, config_.fast_start_lead_ms);
+    async_pacer_.reset();
+    async_startup_deadline_ = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(config_.connect_timeout_ms);
+    setState(STATE_CONNECTING);
+
+    // 解析完成时写入请求的eventfd；字面量地址和缓存命中时已经完成，直接发起连接
+    connect_started_ = std::chrono::steady_clock::now();
+    async_resolve_ = RTMPResolver::instance().resolve(server_host_, server_port_, resolveOptions());
+    if (async_resolve_->isDone() && !asyncStartConnect()) {
+        async_mode_ = false;
+        return false;
+    }
+    return true;
+}
+
+int RTMPClient::socketFd() const {
+    return socket_fd_;
+}
+
+int RTMPClient::pollFd() const {
+    switch (async_phase_) {
+        case ASYNC_RESOLVING:
+            return async_resolve_->eventFd();
+        case ASYNC_TCP_CONNECTING:
+            return connect_race_.pollFd();
+        default:
+            return socket_fd_;
+    }
+}
+
+bool RTMPClient::asyncStartConnect() {
+    if (!async_resolve_->succeeded()) {
+        return asyncFail(async_resolve_->error());
+    }
+    if (!startConnectRace(*async_resolve_)) {
+        return asyncFail(connect_race_.lastError());
+    }
+    async_phase_ = ASYNC_TCP_CONNECTING;
+    return asyncStepConnect();
+}
+
+bool RTMPClient::asyncStepConnect() {
+    RTMPConnectRace::Status status = connect_race_.step();
+    if (status == RTMPConnectRace::RACE_RUNNING) {
+        return true;
+    }
+    if (!finishConnectRace(status)) {
+        return asyncFail(getLastError());
+    }
+
+    // 事件循环随后把socket注册到epoll，注册时的可写事件驱动后续的读写
+    RTMP_LOG_DEBUG(*this, "TCP连接建立成功，发送C0+C1");
+    setState(STATE_HANDSHAKING);
+    async_phase_ = ASYNC_HANDSHAKING;
+
+    std::vector<uint8_t> c0c1;
+    generateC0C1(c0c1);
+    struct iovec iov;
+    iov.iov_base = c0c1.data();
+    iov.iov_len = c0c1.size();
+    return asyncWrite(&iov, 1);
+}
+
+bool RTMPClient::asyncSucceeded() const {
+    return async_phase_ == ASYNC_DONE;
+}
+
+std::chrono::steady_clock::time_point RTMPClient::nextTimerDeadline() const {
+    switch (async_phase_) {
+        case ASYNC_TCP_CONNECTING:
+            return std::min(async_startup_deadline_, connect_race_.nextAttemptTime());
+        case ASYNC_RESOLVING:
+        case ASYNC_HANDSHAKING:
+        case ASYNC_CONNECT_SENT:
+        case ASYNC_CREATE_STREAM_SENT:
+        case ASYNC_PUBLISH_SENT:
+            return async_startup_deadline_;
+        case ASYNC_PUBLISHING: {
+            auto deadline = std::chrono::steady_clock::time_point::max();
+            if (config_.enable_heartbeat) {
+                deadline = async_next_heartbeat_;
+            }
+            // 输出积压时等待可写事件，而不是定时读取下一帧
+            if (async_tag_pending_ && async_output_.size() - async_output_offset_ < ASYNC_OUTPUT_HIGH_WATER) {
+                deadline = std::min(deadline, async_tag_due_);
+            }
+            return deadline;
+        }
+        default:
+            return std::chrono::steady_clock::time_point::max();
+    }
+}
+
+bool RTMPClient::onSocketEvent(uint32_t events) {
+    if (async_phase_ == ASYNC_DONE || async_phase_ == ASYNC_FAILED) {
+        return false;
+    }
+
+    // 解析和连接阶段的事件来自解析请求的eventfd和并行连接的epoll，不是socket本身
+    if (async_phase_ == ASYNC_RESOLVING) {
+        return !async_resolve_->isDone() || asyncStartConnect();
+    }
+    if (async_phase_ == ASYNC_TCP_CONNECTING) {
+        return asyncStepConnect();
+    }
+
+    if (events & EPOLLERR) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(socket_fd_, SOL_SOCKET, SO_ERROR, &error, &len);
+        return asyncFail("Socket error: " + std::string(strerror(error)));
+    }
+
+    // 边沿触发：读写都必须进行到EAGAIN
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        if (!asyncReadInput()) {
+            return false;
+        }
+    }
+
+    if (!asyncFlushOutput()) {
+        return false;
+    }
+
+    return asyncAdvance();
+}
+
+bool RTMPClient::onTimer() {
+    if (async_phase_ == ASYNC_DONE || async_phase_ == ASYNC_FAILED) {
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (async_phase_ < ASYNC_PUBLISHING) {
+        if (now >= async_startup_deadline_) {
+            return asyncFail(async_phase_ == ASYNC_RESOLVING ? "DNS resolution timeout: " + server_host_
+                                                             : "Connection timeout");
+        }
+        // 到期发起下一个地址的连接尝试
+        if (async_phase_ == ASYNC_TCP_CONNECTING) {
+            return asyncStepConnect();
+        }
+        return true;
+    }
+
+    if (config_.enable_heartbeat && now >= async_next_heartbeat_) {
+        async_next_heartbeat_ = now + std::chrono::milliseconds(config_.heartbeat_interval_ms);
+        if (!sendHeartbeat()) {
+            return asyncFail("Heartbeat failed");
+        }
+    }
+
+    return asyncAdvance();
+}
+
+bool RTMPClient::asyncWrite(const struct iovec* iov, size_t count) {
+    size_t index = 0;
+    size_t skip = 0;
+
+    // 输出缓冲区为空时直接写socket，否则必须排在已缓冲数据之后
+    if (async_output_offset_ == async_output_.size() && async_phase_ != ASYNC_TCP_CONNECTING) {
+        while (index < count) {
+            struct iovec local[64];
+            size_t n = 0;
+            for (size_t i = index; i < count && n < 64; ++i, ++n) {
+                local[n] = iov[i];
+            }
+            local[0].iov_base = static_cast<uint8_t*>(local[0].iov_base) + skip;
+            local[0].iov_len -= skip;
+
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = local;
+            msg.msg_iovlen = n;
+
+            ssize_t written = sendmsg(socket_fd_, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                return asyncFail("Failed to send data: " + std::string(strerror(errno)));
+            }
+
+            size_t remaining = static_cast<size_t>(written);
+            while (index < count && remaining >= iov[index].iov_len - skip) {
+                remaining -= iov[index].iov_len - skip;
+                skip = 0;
+                ++index;
+            }
+            skip += remaining;
+        }
+    }
+
+    // 未写出的部分拷贝到输出缓冲区，调用者的负载随后可以释放
+    for (size_t i = index; i < count; ++i) {
+        const uint8_t* base = static_cast<const uint8_t*>(iov[i].iov_base);
+        async_output_.insert(async_output_.end(), base + skip, base + iov[i].iov_len);
+        skip = 0;
+    }
+
+    return true;
+}
+
+bool RTMPClient::asyncFlushOutput() {
+    while (async_output_offset_ < async_output_.size()) {
+        ssize_t n = send(socket_fd_, async_output_.data() + async_output_offset_,
+                         async_output_.size() - async_output_offset_, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return asyncFail("Failed to send data: " + std::string(strerror(errno)));
+        }
+        async_output_offset_ += n;
+    }
+
+    if (async_output_offset_ == async_output_.size()) {
+        async_output_.clear();
+        async_output_offset_ = 0;
+    } else if (async_output_offset_ > ASYNC_OUTPUT_HIGH_WATER) {
+        async_output_.erase(async_output_.begin(), async_output_.begin() + async_output_offset_);
+        async_output_offset_ = 0;
+    }
+
+    return true;
+}
+
+bool RTMPClient::asyncReadInput() {
+    while (true) {
+        ssize_t n = recvInbound(MSG_DONTWAIT);
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0) {
+            return asyncFail("Connection closed by server");
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        return asyncFail("Failed to receive data: " + std::string(strerror(errno)));
+    }
+
+    if (async_phase_ == ASYNC_HANDSHAKING) {
+        // 流水线启动时收到S0+S1即可发送C2，S2随后丢弃
+        size_t needed = config_.pipelined_startup ? 1 + 1536 : HANDSHAKE_RESPONSE_SIZE;
+        if (inbound_end_ - inbound_offset_ < needed) {
+            return true;
+        }
+
+        // 发送C2，随后立即通告块大小并发送connect命令
+        const uint8_t* s1 = inbound_buffer_.data() + inbound_offset_ + 1;
+        std::vector<uint8_t> c2(s1, s1 + 1536);
+        inbound_offset_ += needed;
+        async_s2_remaining_ = HANDSHAKE_RESPONSE_SIZE - needed;
+
+        // 流水线启动的C2和命令合并发送，避免被Nagle算法推迟
+        if (config_.pipelined_startup) {
+            RTMPSocketTuning::setCork(socket_fd_, true);
+        }
+        struct iovec iov;
+        iov.iov_base = c2.data();
+        iov.iov_len = c2.size();
+        std::string error;
+        if (!asyncWrite(&iov, 1)) {
+            error = "Failed to send C2";
+        } else if (config_.chunk_size != out_chunk_size_ && !sendSetChunkSize(config_.chunk_size)) {
+            error = "Failed to send Set Chunk Size";
+        } else if (!sendConnectCommand()) {
+            error = "Failed to send connect command";
+        } else if (config_.pipelined_startup && !sendPipelinedCommands()) {
+            error = "Failed to send startup commands";
+        }
+        if (config_.pipelined_startup) {
+            RTMPSocketTuning::setCork(socket_fd_, false);
+        }
+        if (!error.empty()) {
+            return asyncFail(error);
+        }
+
+        setState(STATE_CONNECTED);
+        RTMP_LOG_DEBUG(*this, "RTMP握手完成，已发送connect命令");
+        async_phase_ = ASYNC_CONNECT_SENT;
+    }
+
+    if (async_s2_remaining_ > 0) {
+        size_t skip = std::min(async_s2_remaining_, inbound_end_ - inbound_offset_);
+        inbound_offset_ += skip;
+        async_s2_remaining_ -= skip;
+        if (async_s2_remaining_ > 0) {
+            return true;
+        }
+    }
+
+    if (async_phase_ >= ASYNC_CONNECT_SENT && !demuxInbound()) {
+        return asyncFail("Failed to parse RTMP message");
+    }
+
+    return true;
+}
+
+bool RTMPClient::asyncAdvance() {
+    // 按命令响应推进连接状态机
+    // 流水线启动时createStream和publish已随connect发出，只需等待响应
+    if (async_phase_ == ASYNC_CONNECT_SENT && connect_succeeded_) {
+        if (pipelined_stream_id_ == 0 && (!sendReleaseStreamCommands() || !sendCreateStreamCommand())) {
+            return asyncFail("Failed to send createStream command");
+        }
+        async_phase_ = ASYNC_CREATE_STREAM_SENT;
+    }
+
+    if (async_phase_ == ASYNC_CREATE_STREAM_SENT && stream_created_) {
+        bool sent = pipelined_stream_id_ != 0 ? checkPipelinedPublish() : sendPublishCommand();
+        if (!sent) {
+            return asyncFail("Failed to send publish command");
+        }
+        async_phase_ = ASYNC_PUBLISH_SENT;
+    }
+
+    if (async_phase_ == ASYNC_PUBLISH_SENT && publish_started_) {
+        setState(STATE_PUBLISHING);
+        recordStartup();
+        async_phase_ = ASYNC_PUBLISHING;
+        resetCongestionMonitor();
+        async_next_heartbeat_ = std::chrono::steady_clock::now() +
+                                std::chrono::milliseconds(config_.heartbeat_interval_ms);
+    }
+
+    if (async_phase_ == ASYNC_PUBLISHING && !asyncPumpMedia()) {
+        return false;
+    }
+
+    if (async_phase_ == ASYNC_DRAINING && async_output_offset_ == async_output_.size()) {
+        RTMP_LOG_INFO(*this, "FLV文件推送成功");
+        async_phase_ = ASYNC_DONE;
+        async_source_.close();
+        return false;
+    }
+
+    return async_phase_ != ASYNC_FAILED;
+}
+
+bool RTMPClient::asyncPumpMedia() {
+    auto now = std::chrono::steady_clock::now();
+
+    // 输出缓冲区积压时停止读取，等待可写事件
+    while (async_output_.size() - async_output_offset_ < ASYNC_OUTPUT_HIGH_WATER) {
+        if (!async_tag_pending_) {
+            if (!async_source_.next(async_tag_)) {
+                async_phase_ = ASYNC_DRAINING;
+                return true;
+            }
+            async_tag_pending_ = true;
+            asyncScheduleTag(now);
+        }
+
+        // 按标签时间戳节奏发送，未到时间则等待定时器
+        if (async_tag_due_ > now) {
+            return true;
+        }
+
+        recordPacing(std::chrono::duration_cast<std::chrono::microseconds>(now - async_tag_due_).count(),
+                     async_pacer_.resyncs());
+        if (config_.read_ahead_ms > 0) {
+            recordReadAhead(async_source_);
+        }
+        
+        // 聚合窗口内的后续小标签随本标签一起发送；第一个放不下的标签留作下一个待发送标签
+        async_group_.assign(1, async_tag_);
+        async_tag_pending_ = false;
+        if (isAggregatable(async_tag_)) {
+            size_t body_size = AGGREGATE_TAG_OVERHEAD + async_tag_.data_size;
+            FLVTagView next;
+            while (async_source_.next(next)) {
+                if (!fitsAggregate(async_group_[0], body_size, next)) {
+                    async_tag_ = next;
+                    async_tag_pending_ = true;
+                    asyncScheduleTag(now);
+                    break;
+                }
+                async_group_.push_back(next);
+                body_size += AGGREGATE_TAG_OVERHEAD + next.data_size;
+            }
+        }
+        if (!sendFLVTags(async_group_.data(), async_group_.size())) {
+            return asyncFail("Failed to send FLV tag");
+        }
+    }
+
+    return true;
+}
+
+void RTMPClient::asyncScheduleTag(std::chrono::steady_clock::time_point now) {
+    bool bursting = async_pacer_.inFastStart();
+    int64_t due = async_pacer_.schedule(async_tag_.timestamp,
+                                        classifyFLVTag(async_tag_) == FRAME_CLASS_KEY);
+    if (bursting) {
+        // 快速启动阶段的标签不等待定时器；结束突发的标签以当前时刻为基准
+        async_tag_due_ = now;
+        if (!async_pacer_.inFastStart()) {
+            RTMP_LOG_INFO_F(*this, "快速启动结束, 已立即发送到时间戳%u", async_tag_.timestamp);
+        }
+    } else {
+        async_tag_due_ = RTMPPacer::toTimePoint(due);
+    }
+}
+
+bool RTMPClient::asyncFail(const std::string& error) {
+    if (async_phase_ != ASYNC_FAILED) {
+        async_phase_ = ASYNC_FAILED;
+        setError(error);
+    }
+    async_source_.close();
+    return false;
+}
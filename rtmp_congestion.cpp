@@ -0,0 +1,142 @@
+#include "rtmp_congestion.h"
+#include "rtmp_pacer.h"
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/sockios.h>
+#include <linux/tcp.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+RTMPCongestionMonitor::RTMPCongestionMonitor()
+    : sample_interval_ns_(100LL * 1000000)
+    , drop_disposable_ms_(500)
+    , drop_inter_ms_(1500)
+    , next_sample_ns_(0)
+    , last_sample_ns_(0)
+    , last_bytes_acked_(0)
+    , level_(CONGESTION_NONE)
+    , level_changes_(0) {
+}
+
+void RTMPCongestionMonitor::configure(uint32_t sample_interval_ms, uint32_t drop_disposable_ms,
+                                      uint32_t drop_inter_ms) {
+    sample_interval_ns_ = static_cast<int64_t>(sample_interval_ms) * 1000000;
+    drop_disposable_ms_ = drop_disposable_ms;
+    drop_inter_ms_ = drop_inter_ms;
+}
+
+void RTMPCongestionMonitor::reset() {
+    next_sample_ns_ = 0;
+    last_sample_ns_ = 0;
+    last_bytes_acked_ = 0;
+    last_sample_ = CongestionSample();
+    level_ = CONGESTION_NONE;
+    level_changes_ = 0;
+}
+
+bool RTMPCongestionMonitor::sampleIfDue(int fd) {
+    int64_t now = RTMPPacer::nowNs();
+    if (now < next_sample_ns_) {
+        return false;
+    }
+    next_sample_ns_ = now + sample_interval_ns_;
+    return sample(fd);
+}
+
+bool RTMPCongestionMonitor::sample(int fd) {
+    struct tcp_info info;
+    memset(&info, 0, sizeof(info));
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) {
+        return false;
+    }
+
+    int outq = 0;
+    if (ioctl(fd, SIOCOUTQ, &outq) < 0) {
+        return false;
+    }
+
+    CongestionSample sample;
+    sample.rtt_us = info.tcpi_rtt;
+    sample.rtt_var_us = info.tcpi_rttvar;
+    sample.cwnd = info.tcpi_snd_cwnd;
+    sample.mss = info.tcpi_snd_mss;
+    sample.outq_bytes = static_cast<uint32_t>(outq);
+    // 旧内核返回的结构较短，没有的字段保持为0
+    if (len >= offsetof(struct tcp_info, tcpi_notsent_bytes) + sizeof(info.tcpi_notsent_bytes)) {
+        sample.notsent_bytes = info.tcpi_notsent_bytes;
+    }
+    if (len >= offsetof(struct tcp_info, tcpi_delivery_rate) + sizeof(info.tcpi_delivery_rate)) {
+        sample.delivery_rate = info.tcpi_delivery_rate;
+    }
+    
+    // 排空速率按1/4权重平滑。上次采样时没有未发送的数据说明这段时间受应用发送量限制，
+    // 测得的速率低于链路能力，只用来提高估计值
+    int64_t now = RTMPPacer::nowNs();
+    sample.drain_rate = last_sample_.drain_rate;
+    if (len >= offsetof(struct tcp_info, tcpi_bytes_acked) + sizeof(info.tcpi_bytes_acked)) {
+        if (last_sample_ns_ > 0 && now > last_sample_ns_ && info.tcpi_bytes_acked >= last_bytes_acked_) {
+            uint64_t rate = (info.tcpi_bytes_acked - last_bytes_acked_) * 1000000000ULL /
+                            static_cast<uint64_t>(now - last_sample_ns_);
+            if (last_sample_.notsent_bytes > 0) {
+                sample.drain_rate = sample.drain_rate == 0 ? rate : (sample.drain_rate * 3 + rate) / 4;
+            } else {
+                sample.drain_rate = std::max(sample.drain_rate, rate);
+            }
+        }
+        last_bytes_acked_ = info.tcpi_bytes_acked;
+    }
+    last_sample_ns_ = now;
+    sample.queued_ms = estimateQueuedMs(sample);
+    last_sample_ = sample;
+
+    // 超过阈值立即降级，降到阈值一半以下才恢复，避免在阈值附近来回切换
+    int level = level_;
+    bool drop_inter = drop_inter_ms_ > 0 &&
+        (sample.queued_ms >= drop_inter_ms_ ||
+         (level == CONGESTION_DROP_INTER && sample.queued_ms >= drop_inter_ms_ / 2));
+    bool drop_disposable = drop_disposable_ms_ > 0 &&
+        (sample.queued_ms >= drop_disposable_ms_ ||
+         (level != CONGESTION_NONE && sample.queued_ms >= drop_disposable_ms_ / 2));
+    int target = drop_inter ? CONGESTION_DROP_INTER :
+                 (drop_disposable ? CONGESTION_DROP_DISPOSABLE : CONGESTION_NONE);
+    if (target != level) {
+        level_ = target;
+        level_changes_++;
+    }
+    return true;
+}
+
+uint32_t RTMPCongestionMonitor::estimateQueuedMs(const CongestionSample& sample) const {
+    if (sample.outq_bytes == 0) {
+        return 0;
+    }
+
+    uint64_t rate = sample.drain_rate;
+    if (rate == 0) {
+        rate = sample.delivery_rate;
+    }
+    if (rate == 0 && sample.rtt_us > 0) {
+        rate = static_cast<uint64_t>(sample.cwnd) * sample.mss * 1000000 / sample.rtt_us;
+    }
+    if (rate == 0) {
+        return 0;
+    }
+
+    uint64_t ms = static_cast<uint64_t>(sample.outq_bytes) * 1000 / rate;
+    return ms > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(ms);
+}
+
+CongestionLevel RTMPCongestionMonitor::level() const {
+    return static_cast<CongestionLevel>(level_.load());
+}
+
+const CongestionSample& RTMPCongestionMonitor::lastSample() const {
+    return last_sample_;
+}
+
+uint64_t RTMPCongestionMonitor::levelChanges() const {
+    return level_changes_;
+}
@@ -0,0 +1,62 @@
+#ifndef RTMP_CONGESTION_H
+#define RTMP_CONGESTION_H
+
+#include <atomic>
+#include <cstdint>
+
+// 拥塞等级，数值越大降级越多
+enum CongestionLevel {
+    CONGESTION_NONE = 0,
+    CONGESTION_DROP_DISPOSABLE = 1,     // 丢弃可丢弃帧
+    CONGESTION_DROP_INTER = 2           // 丢弃P帧直到下一个关键帧
+};
+
+// 一次TCP状态采样
+struct CongestionSample {
+    uint32_t rtt_us = 0;            // 平滑RTT
+    uint32_t rtt_var_us = 0;
+    uint32_t cwnd = 0;              // 拥塞窗口(报文段)
+    uint32_t mss = 0;
+    uint64_t delivery_rate = 0;     // 内核估计的最近交付速率(字节/秒)，不支持时为0
+    uint64_t drain_rate = 0;        // 按两次采样间被确认的字节数平滑得到的排空速率(字节/秒)
+    uint32_t outq_bytes = 0;        // 发送队列中未确认和未发送的字节数(SIOCOUTQ)
+    uint32_t notsent_bytes = 0;     // 其中尚未发送的字节数
+    uint32_t queued_ms = 0;         // 按当前速率排空发送队列需要的时间，即积压的媒体时长
+};
+
+// 每个推流会话的拥塞监测器：按采样间隔读取TCP_INFO和SIOCOUTQ，
+// 用排空速率估算内核发送队列中积压的媒体时长，超过阈值时提高拥塞等级，降到阈值一半以下时恢复。
+// 排空速率取两次采样之间被确认字节数的平滑值；内核的交付速率在接收窗口反复关闭打开时
+// 波动很大，只在还没有排空速率时使用，再没有时按一个RTT发送一个拥塞窗口估算。
+// sample()由发送线程调用，level()可在任意线程读取。
+class RTMPCongestionMonitor {
+public:
+    RTMPCongestionMonitor();
+
+    void configure(uint32_t sample_interval_ms, uint32_t drop_disposable_ms, uint32_t drop_inter_ms);
+    void reset();
+
+    // 距上次采样超过采样间隔时采样，返回是否进行了采样
+    bool sampleIfDue(int fd);
+    bool sample(int fd);
+
+    CongestionLevel level() const;
+    const CongestionSample& lastSample() const;
+    uint64_t levelChanges() const;
+
+private:
+    uint32_t estimateQueuedMs(const CongestionSample& sample) const;
+
+    int64_t sample_interval_ns_;
+    uint32_t drop_disposable_ms_;
+    uint32_t drop_inter_ms_;
+
+    int64_t next_sample_ns_;
+    int64_t last_sample_ns_;
+    uint64_t last_bytes_acked_;
+    CongestionSample last_sample_;
+    std::atomic<int> level_;
+    uint64_t level_changes_;
+};
+
+#endif // RTMP_CONGESTION_H
@@ -0,0 +1,244 @@
+#include "rtmp_connect_race.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include <cstring>
+
+// RFC 8305建议的连接尝试间隔下限
+static const uint32_t MIN_ATTEMPT_DELAY_MS = 10;
+
+RTMPConnectRace::RTMPConnectRace()
+    : epoll_fd_(-1)
+    , attempt_delay_(250)
+    , next_index_(0)
+    , started_(0)
+    , winner_fd_(-1)
+    , winner_index_(0)
+    , connected_(false) {
+}
+
+RTMPConnectRace::~RTMPConnectRace() {
+    cancel();
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+bool RTMPConnectRace::start(const std::vector<ResolvedAddress>& addresses, uint32_t attempt_delay_ms,
+                            const SocketSetup& setup) {
+    cancel();
+    failed_.clear();
+    last_error_.clear();
+    if (addresses.empty()) {
+        last_error_ = "No address to connect";
+        return false;
+    }
+    if (epoll_fd_ < 0) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            last_error_ = "Failed to create epoll: " + std::string(strerror(errno));
+            return false;
+        }
+    }
+
+    addresses_ = addresses;
+    attempt_delay_ = std::chrono::milliseconds(std::max(attempt_delay_ms, MIN_ATTEMPT_DELAY_MS));
+    setup_ = setup;
+    next_index_ = 0;
+    started_ = 0;
+    startNextAttempt();
+    return true;
+}
+
+void RTMPConnectRace::cancel() {
+    while (!attempts_.empty()) {
+        closeAttempt(attempts_.size() - 1);
+    }
+    if (winner_fd_ >= 0) {
+        close(winner_fd_);
+        winner_fd_ = -1;
+    }
+    connected_ = false;
+    next_index_ = addresses_.size();
+    next_attempt_time_ = std::chrono::steady_clock::time_point::max();
+}
+
+void RTMPConnectRace::startNextAttempt() {
+    // 无法发起的地址直接跳过，继续下一个
+    while (next_index_ < addresses_.size() && !connected_) {
+        size_t index = next_index_++;
+        const ResolvedAddress& address = addresses_[index];
+
+        int fd = socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            last_error_ = "Failed to create socket: " + std::string(strerror(errno));
+            failed_.push_back(address);
+            continue;
+        }
+        started_++;
+        if (setup_) {
+            setup_(fd, index);
+        }
+
+        int result = ::connect(fd, reinterpret_cast<const struct sockaddr*>(&address.addr), address.length);
+        if (result == 0) {
+            winner_fd_ = fd;
+            winner_index_ = index;
+            connected_ = true;
+            break;
+        }
+        if (errno != EINPROGRESS) {
+            last_error_ = "Failed to connect to " + address.toString() + ": " + strerror(errno);
+            failed_.push_back(address);
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLOUT;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            last_error_ = "epoll_ctl failed: " + std::string(strerror(errno));
+            failed_.push_back(address);
+            close(fd);
+            continue;
+        }
+
+        Attempt attempt;
+        attempt.fd = fd;
+        attempt.index = index;
+        attempts_.push_back(attempt);
+        next_attempt_time_ = std::chrono::steady_clock::now() + attempt_delay_;
+        return;
+    }
+
+    next_attempt_time_ = std::chrono::steady_clock::time_point::max();
+    if (connected_) {
+        // 获胜后关闭其余的尝试
+        while (!attempts_.empty()) {
+            closeAttempt(attempts_.size() - 1);
+        }
+    }
+}
+
+void RTMPConnectRace::closeAttempt(size_t position) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, attempts_[position].fd, nullptr);
+    close(attempts_[position].fd);
+    attempts_.erase(attempts_.begin() + position);
+}
+
+RTMPConnectRace::Status RTMPConnectRace::step() {
+    if (connected_) {
+        return RACE_CONNECTED;
+    }
+
+    struct epoll_event events[16];
+    int n;
+    do {
+        n = epoll_wait(epoll_fd_, events, 16, 0);
+        for (int i = 0; i < n && !connected_; ++i) {
+            size_t position = 0;
+            while (position < attempts_.size() && attempts_[position].fd != events[i].data.fd) {
+                ++position;
+            }
+            if (position == attempts_.size()) {
+                continue;
+            }
+
+            int error = 0;
+            socklen_t len = sizeof(error);
+            if (getsockopt(attempts_[position].fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+                error = errno;
+            }
+            if (error == 0) {
+                winner_fd_ = attempts_[position].fd;
+                winner_index_ = attempts_[position].index;
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, winner_fd_, nullptr);
+                attempts_.erase(attempts_.begin() + position);
+                connected_ = true;
+                while (!attempts_.empty()) {
+                    closeAttempt(attempts_.size() - 1);
+                }
+                next_attempt_time_ = std::chrono::steady_clock::time_point::max();
+                return RACE_CONNECTED;
+            }
+
+            // 失败的尝试不再等待间隔，立即发起下一个
+            const ResolvedAddress& address = addresses_[attempts_[position].index];
+            last_error_ = "Failed to connect to " + address.toString() + ": " + strerror(error);
+            failed_.push_back(address);
+            closeAttempt(position);
+            next_attempt_time_ = std::chrono::steady_clock::now();
+        }
+    } while (n == 16 && !connected_);
+
+    if (!connected_ && next_index_ < addresses_.size() &&
+        std::chrono::steady_clock::now() >= next_attempt_time_) {
+        startNextAttempt();
+    }
+    return status();
+}
+
+RTMPConnectRace::Status RTMPConnectRace::status() const {
+    if (connected_) {
+        return RACE_CONNECTED;
+    }
+    if (attempts_.empty() && next_index_ >= addresses_.size()) {
+        return RACE_FAILED;
+    }
+    return RACE_RUNNING;
+}
+
+RTMPConnectRace::Status RTMPConnectRace::run(int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        Status result = step();
+        if (result != RACE_RUNNING) {
+            return result;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            last_error_ = "Connection timeout";
+            cancel();
+            return RACE_FAILED;
+        }
+        auto wake = std::min(deadline, next_attempt_time_);
+        auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count() + 1;
+        struct epoll_event event;
+        epoll_wait(epoll_fd_, &event, 1, static_cast<int>(wait_ms));
+    }
+}
+
+int RTMPConnectRace::pollFd() const {
+    return epoll_fd_;
+}
+
+std::chrono::steady_clock::time_point RTMPConnectRace::nextAttemptTime() const {
+    return next_attempt_time_;
+}
+
+int RTMPConnectRace::takeSocket() {
+    int fd = winner_fd_;
+    winner_fd_ = -1;
+    return fd;
+}
+
+const ResolvedAddress& RTMPConnectRace::winner() const {
+    return addresses_[winner_index_];
+}
+
+size_t RTMPConnectRace::attemptsStarted() const {
+    return started_;
+}
+
+const std::vector<ResolvedAddress>& RTMPConnectRace::failedAddresses() const {
+    return failed_;
+}
+
+const std::string& RTMPConnectRace::lastError() const {
+    return last_error_;
+}
@@ -0,0 +1,81 @@
+#ifndef RTMP_CONNECT_RACE_H
+#define RTMP_CONNECT_RACE_H
+
+#include "rtmp_resolver.h"
+#include <functional>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+// 按RFC 8305(Happy Eyeballs)并行连接多个地址：每隔attempt_delay_ms按顺序发起下一个
+// 非阻塞连接，某个尝试失败时立即发起下一个；第一个完成的连接获胜，其余的关闭。
+// 进行中的尝试注册在内部的epoll实例上，pollFd()可以嵌套到外层epoll中等待；
+// 阻塞调用者直接使用run()。
+// 非线程安全。
+class RTMPConnectRace {
+public:
+    // 新socket在connect之前调用，attempt为尝试序号(从0开始)
+    typedef std::function<void(int fd, size_t attempt)> SocketSetup;
+
+    enum Status {
+        RACE_RUNNING,
+        RACE_CONNECTED,
+        RACE_FAILED
+    };
+
+    RTMPConnectRace();
+    ~RTMPConnectRace();
+
+    bool start(const std::vector<ResolvedAddress>& addresses, uint32_t attempt_delay_ms,
+               const SocketSetup& setup);
+    void cancel();
+
+    // 发起到期的尝试并收集完成的连接，不阻塞
+    Status step();
+    // 阻塞直到连接成功、全部失败或超时
+    Status run(int timeout_ms);
+
+    int pollFd() const;
+    // 下一次发起尝试的时刻，没有待发起的地址时为time_point::max()
+    std::chrono::steady_clock::time_point nextAttemptTime() const;
+
+    // 取走获胜的socket(仍为非阻塞模式)，之后由调用者负责关闭
+    int takeSocket();
+    const ResolvedAddress& winner() const;
+    size_t attemptsStarted() const;
+    // 连接失败的地址，调用者可以报告给解析器
+    const std::vector<ResolvedAddress>& failedAddresses() const;
+    const std::string& lastError() const;
+
+private:
+    RTMPConnectRace(const RTMPConnectRace&);
+    RTMPConnectRace& operator=(const RTMPConnectRace&);
+
+    struct Attempt {
+        int fd;
+        size_t index;               // 在addresses_中的位置
+    };
+
+    void startNextAttempt();
+    void closeAttempt(size_t position);
+    Status status() const;
+
+    int epoll_fd_;
+    std::vector<ResolvedAddress> addresses_;
+    std::chrono::milliseconds attempt_delay_;
+    SocketSetup setup_;
+
+    size_t next_index_;
+    size_t started_;                // 已创建socket的尝试数
+    std::chrono::steady_clock::time_point next_attempt_time_;
+    std::vector<Attempt> attempts_;     // 进行中的尝试
+    std::vector<ResolvedAddress> failed_;
+
+    int winner_fd_;
+    size_t winner_index_;
+    bool connected_;
+    std::string last_error_;
+};
+
+#endif // RTMP_CONNECT_RACE_H
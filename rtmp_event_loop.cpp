@@ -0,0 +1,345 @@
+#include "rtmp_event_loop.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+
+// epoll_wait的最长等待时间，保证停止请求能及时响应
+static const int MAX_WAIT_MS = 100;
+
+RTMPEventLoop::RTMPEventLoop(size_t thread_count)
+    : thread_count_(thread_count)
+    , running_(false) {
+    if (thread_count_ == 0) {
+        thread_count_ = std::thread::hardware_concurrency();
+        if (thread_count_ == 0) {
+            thread_count_ = 1;
+        }
+    }
+}
+
+RTMPEventLoop::~RTMPEventLoop() {
+    stop();
+}
+
+bool RTMPEventLoop::start() {
+    if (running_) {
+        return true;
+    }
+
+    for (size_t i = 0; i < thread_count_; ++i) {
+        std::unique_ptr<Shard> shard(new Shard());
+        shard->index = i;
+        shard->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        shard->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (shard->epoll_fd < 0 || shard->wake_fd < 0) {
+            std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
+            if (shard->epoll_fd >= 0) close(shard->epoll_fd);
+            if (shard->wake_fd >= 0) close(shard->wake_fd);
+            shards_.clear();
+            return false;
+        }
+
+        // 唤醒fd的data.ptr为空，用于和会话事件区分
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->wake_fd, &ev);
+
+        shards_.push_back(std::move(shard));
+    }
+
+    running_ = true;
+
+    unsigned int cpu_count = std::thread::hardware_concurrency();
+    for (auto& shard : shards_) {
+        Shard* raw = shard.get();
+        shard->thread = std::thread([this, raw] { shardLoop(*raw); });
+
+        // 每个分片绑定到一个CPU核，会话状态始终留在同一个核的缓存中
+        if (cpu_count > 0 && thread_count_ <= cpu_count) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(shard->index % cpu_count, &cpuset);
+            pthread_setaffinity_np(shard->thread.native_handle(), sizeof(cpuset), &cpuset);
+        }
+    }
+
+    return true;
+}
+
+void RTMPEventLoop::stop() {
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    for (auto& shard : shards_) {
+        wakeShard(*shard);
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+        close(shard->epoll_fd);
+        close(shard->wake_fd);
+    }
+    shards_.clear();
+}
+
+bool RTMPEventLoop::addSession(const std::shared_ptr<RTMPClient>& session, const std::string& url,
+                               const std::string& flv_file, FinishCallback on_finish) {
+    if (!running_ || !session) {
+        return false;
+    }
+
+    // 分配到会话数最少的分片
+    Shard* target = shards_[0].get();
+    for (auto& shard : shards_) {
+        if (shard->session_count < target->session_count) {
+            target = shard.get();
+        }
+    }
+    target->session_count++;
+
+    Command command;
+    command.remove = false;
+    command.session.client = session;
+    command.session.url = url;
+    command.session.flv_file = flv_file;
+    command.session.on_finish = on_finish;
+    command.session.deadline = TimePoint::max();
+    {
+        std::lock_guard<std::mutex> lock(target->command_mutex);
+        target->commands.push_back(command);
+    }
+    wakeShard(*target);
+    return true;
+}
+
+void RTMPEventLoop::removeSession(const std::shared_ptr<RTMPClient>& session) {
+    // 不记录会话所在分片，广播给所有分片，不持有该会话的分片忽略
+    for (auto& shard : shards_) {
+        Command command;
+        command.remove = true;
+        command.session.client = session;
+        {
+            std::lock_guard<std::mutex> lock(shard->command_mutex);
+            shard->commands.push_back(command);
+        }
+        wakeShard(*shard);
+    }
+}
+
+size_t RTMPEventLoop::sessionCount() const {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        count += shard->session_count;
+    }
+    return count;
+}
+
+size_t RTMPEventLoop::threadCount() const {
+    return thread_count_;
+}
+
+void RTMPEventLoop::wakeShard(Shard& shard) {
+    uint64_t one = 1;
+    ssize_t n = write(shard.wake_fd, &one, sizeof(one));
+    (void)n;
+}
+
+void RTMPEventLoop::shardLoop(Shard& shard) {
+    std::vector<struct epoll_event> events(256);
+
+    while (running_) {
+        // 等待到最近的会话定时器
+        int timeout_ms = MAX_WAIT_MS;
+        if (!shard.timers.empty()) {
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                shard.timers.top().deadline - std::chrono::steady_clock::now()).count();
+            timeout_ms = wait <= 0 ? 0 : static_cast<int>(std::min<int64_t>((wait + 999) / 1000, MAX_WAIT_MS));
+        }
+
+        int n = epoll_wait(shard.epoll_fd, events.data(), static_cast<int>(events.size()), timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                uint64_t value;
+                while (read(shard.wake_fd, &value, sizeof(value)) > 0) {
+                }
+                processCommands(shard);
+                continue;
+            }
+
+            RTMPClient* client = static_cast<RTMPClient*>(events[i].data.ptr);
+            auto it = shard.sessions.find(client);
+            if (it == shard.sessions.end()) {
+                continue; // 本轮中已结束的会话
+            }
+
+            if (!client->onSocketEvent(events[i].events) || !registerPollFd(shard, it->second)) {
+                finishSession(shard, client);
+            } else {
+                scheduleTimer(shard, it->second);
+            }
+        }
+
+        // 处理到期定时器；会话的deadline变化后旧条目作废
+        auto now = std::chrono::steady_clock::now();
+        while (!shard.timers.empty() && shard.timers.top().deadline <= now) {
+            TimerEntry entry = shard.timers.top();
+            shard.timers.pop();
+
+            auto it = shard.sessions.find(entry.client);
+            if (it == shard.sessions.end() || it->second.deadline != entry.deadline) {
+                continue;
+            }
+
+            it->second.deadline = TimePoint::max();
+            if (!entry.client->onTimer() || !registerPollFd(shard, it->second)) {
+                finishSession(shard, entry.client);
+            } else {
+                scheduleTimer(shard, it->second);
+            }
+        }
+    }
+
+    // 停止时中止所有会话，包括尚未开始的会话
+    // 回调在锁外调用，回调中可以安全地访问事件循环
+    std::vector<Command> pending;
+    {
+        std::lock_guard<std::mutex> lock(shard.command_mutex);
+        pending.swap(shard.commands);
+    }
+    for (auto& command : pending) {
+        if (!command.remove) {
+            shard.session_count--;
+            if (command.session.on_finish) {
+                command.session.on_finish(*command.session.client, false);
+            }
+        }
+    }
+    while (!shard.sessions.empty()) {
+        finishSession(shard, shard.sessions.begin()->first);
+    }
+}
+
+void RTMPEventLoop::processCommands(Shard& shard) {
+    std::vector<Command> commands;
+    {
+        std::lock_guard<std::mutex> lock(shard.command_mutex);
+        commands.swap(shard.commands);
+    }
+
+    for (auto& command : commands) {
+        if (command.remove) {
+            RTMPClient* client = command.session.client.get();
+            if (shard.sessions.find(client) != shard.sessions.end()) {
+                finishSession(shard, client);
+            }
+        } else {
+            startSession(shard, command.session);
+        }
+    }
+}
+
+void RTMPEventLoop::startSession(Shard& shard, Session& session) {
+    RTMPClient* client = session.client.get();
+
+    if (!client->startAsync(session.url, session.flv_file)) {
+        shard.session_count--;
+        if (session.on_finish) {
+            session.on_finish(*client, false);
+        }
+        return;
+    }
+
+    session.registered_fd = -1;
+    if (!registerPollFd(shard, session)) {
+        client->disconnect();
+        shard.session_count--;
+        if (session.on_finish) {
+            session.on_finish(*client, false);
+        }
+        return;
+    }
+
+    Session& stored = shard.sessions[client];
+    stored = session;
+    stored.deadline = TimePoint::max();
+    scheduleTimer(shard, stored);
+}
+
+bool RTMPEventLoop::registerPollFd(Shard& shard, Session& session) {
+    int fd = session.client->pollFd();
+    if (fd == session.registered_fd) {
+        return true;
+    }
+
+    // 解析请求的eventfd和并行连接的epoll仍由客户端持有，先显式移除
+    if (session.registered_fd >= 0) {
+        epoll_ctl(shard.epoll_fd, EPOLL_CTL_DEL, session.registered_fd, nullptr);
+        session.registered_fd = -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = session.client.get();
+    if (epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        std::cerr << "epoll_ctl failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    session.registered_fd = fd;
+    return true;
+}
+
+void RTMPEventLoop::scheduleTimer(Shard& shard, Session& session) {
+    TimePoint deadline = session.client->nextTimerDeadline();
+    if (deadline == session.deadline) {
+        return;
+    }
+
+    session.deadline = deadline;
+    if (deadline != TimePoint::max()) {
+        TimerEntry entry;
+        entry.deadline = deadline;
+        entry.client = session.client.get();
+        shard.timers.push(entry);
+    }
+}
+
+void RTMPEventLoop::finishSession(Shard& shard, RTMPClient* client) {
+    auto it = shard.sessions.find(client);
+    if (it == shard.sessions.end()) {
+        return;
+    }
+
+    // 先移出映射表，回调中可以安全地重新添加同一个会话
+    Session session = it->second;
+    shard.sessions.erase(it);
+    shard.session_count--;
+
+    if (session.registered_fd >= 0) {
+        epoll_ctl(shard.epoll_fd, EPOLL_CTL_DEL, session.registered_fd, nullptr);
+    }
+    bool success = client->asyncSucceeded();
+    client->disconnect();
+
+    if (session.on_finish) {
+        session.on_finish(*client, success);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef RTMP_EVENT_LOOP_H
+#define RTMP_EVENT_LOOP_H
+
+#include "rtmp_client.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <functional>
+
+// 基于epoll(边沿触发)的事件循环，在少量固定线程上承载大量推流会话。
+// 每个线程是一个分片，拥有自己的epoll实例；会话添加时分配到负载最小的分片，
+// 之后只在该分片线程上被访问。
+class RTMPEventLoop {
+public:
+    // 会话结束回调，在分片线程上调用
+    typedef std::function<void(RTMPClient& session, bool success)> FinishCallback;
+
+    // thread_count为0时使用CPU核数
+    explicit RTMPEventLoop(size_t thread_count = 0);
+    ~RTMPEventLoop();
+
+    bool start();
+    void stop();
+
+    // 添加会话：连接url并推送flv_file，会话对象由事件循环共同持有直到结束
+    bool addSession(const std::shared_ptr<RTMPClient>& session, const std::string& url,
+                    const std::string& flv_file, FinishCallback on_finish = FinishCallback());
+
+    // 中止会话（异步执行，完成后调用其结束回调）
+    void removeSession(const std::shared_ptr<RTMPClient>& session);
+
+    size_t sessionCount() const;
+    size_t threadCount() const;
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct Session {
+        std::shared_ptr<RTMPClient> client;
+        std::string url;
+        std::string flv_file;
+        FinishCallback on_finish;
+        TimePoint deadline;
+        int registered_fd = -1;     // 当前注册在epoll中的fd，解析和连接阶段之后换成socket
+    };
+
+    struct Command {
+        bool remove;
+        Session session;
+    };
+
+    struct TimerEntry {
+        TimePoint deadline;
+        RTMPClient* client;
+        bool operator>(const TimerEntry& other) const { return deadline > other.deadline; }
+    };
+
+    struct Shard {
+        size_t index = 0;
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        std::thread thread;
+
+        // 其他线程提交的添加/移除命令
+        std::mutex command_mutex;
+        std::vector<Command> commands;
+
+        // 仅分片线程访问
+        std::map<RTMPClient*, Session> sessions;
+        std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timers;
+
+        std::atomic<size_t> session_count{0};
+    };
+
+    void shardLoop(Shard& shard);
+    void processCommands(Shard& shard);
+    void startSession(Shard& shard, Session& session);
+    bool registerPollFd(Shard& shard, Session& session);
+    void scheduleTimer(Shard& shard, Session& session);
+    void finishSession(Shard& shard, RTMPClient* client);
+    void wakeShard(Shard& shard);
+
+    size_t thread_count_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> running_;
+};
+
+#endif // RTMP_EVENT_LOOP_H
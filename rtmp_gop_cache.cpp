@@ -0,0 +1,76 @@
+#include "rtmp_gop_cache.h"
+#include "flv_index.h"
+#include "rtmp_client.h"
+
+RTMPGopCache::RTMPGopCache(size_t max_tags)
+    : max_tags_(max_tags)
+    , has_metadata_(false)
+    , has_video_header_(false)
+    , has_audio_header_(false)
+    , gop_overflow_(false)
+    , last_timestamp_(0) {
+}
+
+void RTMPGopCache::add(const FLVTagView& tag) {
+    last_timestamp_ = tag.timestamp;
+    uint8_t flags = FLVIndex::classifyTag(tag);
+    if (flags & FLV_INDEX_METADATA) {
+        metadata_ = tag;
+        has_metadata_ = true;
+        return;
+    }
+    if (flags & FLV_INDEX_SEQUENCE_HEADER) {
+        if (tag.type == FLV_TAG_VIDEO) {
+            video_header_ = tag;
+            has_video_header_ = true;
+        } else {
+            audio_header_ = tag;
+            has_audio_header_ = true;
+        }
+        return;
+    }
+    if (flags & FLV_INDEX_KEYFRAME) {
+        gop_.clear();
+        gop_overflow_ = false;
+        gop_.push_back(tag);
+        return;
+    }
+    // 第一个关键帧之前的标签无法单独解码，不需要补发
+    if (gop_.empty() || gop_overflow_) {
+        return;
+    }
+    if (gop_.size() >= max_tags_) {
+        // 关键帧间隔过长时不再缓存，补发截断的GOP没有意义
+        gop_.clear();
+        gop_overflow_ = true;
+        return;
+    }
+    gop_.push_back(tag);
+}
+
+void RTMPGopCache::clear() {
+    has_metadata_ = false;
+    has_video_header_ = false;
+    has_audio_header_ = false;
+    gop_.clear();
+    gop_overflow_ = false;
+    last_timestamp_ = 0;
+}
+
+void RTMPGopCache::snapshot(std::vector<FLVTagView>& tags) const {
+    tags.clear();
+    uint32_t base = gop_.empty() ? last_timestamp_ : gop_.front().timestamp;
+    const bool present[3] = { has_metadata_, has_video_header_, has_audio_header_ };
+    const FLVTagView* headers[3] = { &metadata_, &video_header_, &audio_header_ };
+    for (int i = 0; i < 3; ++i) {
+        if (present[i]) {
+            tags.push_back(*headers[i]);
+            tags.back().timestamp = base;
+        }
+    }
+    tags.insert(tags.end(), gop_.begin(), gop_.end());
+}
+
+size_t RTMPGopCache::gopTags() const {
+    return gop_.size();
+}
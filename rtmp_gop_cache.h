@@ -0,0 +1,39 @@
+#ifndef RTMP_GOP_CACHE_H
+#define RTMP_GOP_CACHE_H
+
+#include "flv_reader.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// 切换到新连接时需要补发的媒体状态：最近的onMetaData、音视频序列头，
+// 以及当前GOP(最近的视频关键帧及其后已读取的全部音视频标签)。
+// 只保存标签视图，负载在FLVSource关闭前有效。非线程安全。
+class RTMPGopCache {
+public:
+    explicit RTMPGopCache(size_t max_tags = 4096);
+
+    // 按读取顺序加入每个标签
+    void add(const FLVTagView& tag);
+    void clear();
+
+    // 按发送顺序输出补发的标签：元数据和序列头在前，时间戳改为GOP起点，使新连接上的时间戳不回退；
+    // 没有完整GOP(音频流或GOP超过上限)时只有元数据和序列头
+    void snapshot(std::vector<FLVTagView>& tags) const;
+
+    size_t gopTags() const;
+
+private:
+    size_t max_tags_;
+    bool has_metadata_;
+    bool has_video_header_;
+    bool has_audio_header_;
+    FLVTagView metadata_;
+    FLVTagView video_header_;
+    FLVTagView audio_header_;
+    std::vector<FLVTagView> gop_;   // 为空或以关键帧开始
+    bool gop_overflow_;             // 当前GOP超过上限，等待下一个关键帧
+    uint32_t last_timestamp_;
+};
+
+#endif // RTMP_GOP_CACHE_H
@@ -0,0 +1,288 @@
+#include "rtmp_io_uring.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <algorithm>
+
+static inline int ioUringSetup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static inline int ioUringEnter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+}
+
+static inline int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+RTMPIoUring::RTMPIoUring()
+    : ring_fd_(-1)
+    , fixed_file_(false)
+    , file_fd_(-1)
+    , sq_ring_(nullptr)
+    , sq_ring_size_(0)
+    , cq_ring_(nullptr)
+    , cq_ring_size_(0)
+    , sqes_(nullptr)
+    , sqes_size_(0)
+    , sq_head_(nullptr)
+    , sq_tail_(nullptr)
+    , sq_mask_(nullptr)
+    , sq_array_(nullptr)
+    , sq_pending_(0)
+    , cq_head_(nullptr)
+    , cq_tail_(nullptr)
+    , cq_mask_(nullptr)
+    , cqes_(nullptr)
+    , next_user_data_(1) {
+}
+
+RTMPIoUring::~RTMPIoUring() {
+    close();
+}
+
+bool RTMPIoUring::init(unsigned entries) {
+    close();
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = ioUringSetup(entries, &params);
+    if (ring_fd_ < 0) {
+        last_error_ = "io_uring_setup failed: " + std::string(strerror(errno));
+        return false;
+    }
+
+    // 5.5之后的内核：提交后即可释放SQE引用的参数(超时的timespec)，并且支持链接超时
+    if (!(params.features & IORING_FEAT_SUBMIT_STABLE)) {
+        last_error_ = "io_uring kernel support is too old";
+        close();
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        last_error_ = "Failed to map io_uring SQ ring: " + std::string(strerror(errno));
+        close();
+        return false;
+    }
+
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            last_error_ = "Failed to map io_uring CQ ring: " + std::string(strerror(errno));
+            close();
+            return false;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        last_error_ = "Failed to map io_uring SQEs: " + std::string(strerror(errno));
+        close();
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    uint8_t* sq = static_cast<uint8_t*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    uint8_t* cq = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    last_error_.clear();
+    return true;
+}
+
+void RTMPIoUring::close() {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    cq_ring_ = nullptr;
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = nullptr;
+    }
+    // 关闭ring同时释放注册的固定文件
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    fixed_file_ = false;
+    file_fd_ = -1;
+    sq_pending_ = 0;
+}
+
+bool RTMPIoUring::isOpen() const {
+    return ring_fd_ >= 0;
+}
+
+bool RTMPIoUring::registerFile(int fd) {
+    if (ring_fd_ < 0) {
+        return false;
+    }
+    if (ioUringRegister(ring_fd_, IORING_REGISTER_FILES, &fd, 1) < 0) {
+        last_error_ = "Failed to register io_uring file: " + std::string(strerror(errno));
+        return false;
+    }
+    fixed_file_ = true;
+    file_fd_ = fd;
+    return true;
+}
+
+struct io_uring_sqe* RTMPIoUring::getSqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail_ + sq_pending_;
+    if (tail - head > *sq_mask_) {
+        return nullptr;
+    }
+
+    unsigned index = tail & *sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    sq_pending_++;
+    return sqe;
+}
+
+int RTMPIoUring::submitAndWait(unsigned submit, unsigned wait) {
+    if (sq_pending_ > 0) {
+        // 发布新的队尾，内核随后看到已填写的SQE
+        __atomic_store_n(sq_tail_, *sq_tail_ + sq_pending_, __ATOMIC_RELEASE);
+        sq_pending_ = 0;
+    }
+
+    while (true) {
+        int ret = ioUringEnter(ring_fd_, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if (ret >= 0) {
+            return ret;
+        }
+        if (errno != EINTR) {
+            return -errno;
+        }
+        // 被信号打断时内核可能已经消费了部分SQE，按队首重新计算
+        submit = *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    }
+}
+
+bool RTMPIoUring::peekCompletion(struct io_uring_cqe& cqe) {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    cqe = cqes_[head & *cq_mask_];
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+int RTMPIoUring::sendmsg(int fd, const struct msghdr* msg, int flags, uint32_t timeout_ms) {
+    if (ring_fd_ < 0) {
+        return -EBADF;
+    }
+
+    // 每次调用使用新的user_data，完成事件只记到发出它的调用上
+    uint64_t send_id = next_user_data_;
+    next_user_data_ += 2;
+
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe) {
+        return -EBUSY;
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    bool fixed = fixed_file_ && fd == file_fd_;
+    sqe->fd = fixed ? 0 : fd;
+    sqe->flags = fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = send_id;
+
+    unsigned expected = 1;
+    struct __kernel_timespec timeout;
+    if (timeout_ms > 0) {
+        struct io_uring_sqe* link = getSqe();
+        if (link) {
+            timeout.tv_sec = timeout_ms / 1000;
+            timeout.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+            sqe->flags |= IOSQE_IO_LINK;
+            link->opcode = IORING_OP_LINK_TIMEOUT;
+            link->fd = -1;
+            link->addr = reinterpret_cast<uint64_t>(&timeout);
+            link->len = 1;
+            link->user_data = send_id + 1;
+            expected = 2;
+        }
+    }
+
+    // 一次系统调用完成提交和等待；链接超时的完成事件总会产生(超时或被取消)
+    unsigned tail = *sq_tail_;
+    int ret = submitAndWait(expected, expected);
+
+    // 内核没有取走的请求撤回(没有SQPOLL时只有io_uring_enter会读取队列)，
+    // 否则下一次提交会让内核读到本次调用栈上已经失效的msghdr
+    unsigned consumed = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) - tail;
+    if (consumed < expected) {
+        __atomic_store_n(sq_tail_, tail + consumed, __ATOMIC_RELEASE);
+    }
+    if (consumed == 0) {
+        last_error_ = "io_uring_enter failed: " + std::string(strerror(ret < 0 ? -ret : EIO));
+        return ret < 0 ? ret : -EIO;
+    }
+
+    // 取走的请求在完成前仍引用msghdr和数据，全部完成后才能返回
+    int result = -EIO;
+    unsigned reaped = 0;
+    while (reaped < consumed) {
+        struct io_uring_cqe cqe;
+        if (!peekCompletion(cqe)) {
+            ret = submitAndWait(0, 1);
+            if (ret < 0 && ret != -EAGAIN && ret != -EBUSY) {
+                // 无法继续等待：关闭ring让内核取消请求，调用者之后回退到sendmsg
+                last_error_ = "io_uring_enter failed: " + std::string(strerror(-ret));
+                close();
+                return ret;
+            }
+            continue;
+        }
+        if (cqe.user_data == send_id) {
+            result = cqe.res;
+            reaped++;
+        } else if (cqe.user_data == send_id + 1) {
+            reaped++;
+        }
+    }
+
+    // 超时触发时发送请求被取消
+    return result == -ECANCELED ? -ETIME : result;
+}
+
+const std::string& RTMPIoUring::lastError() const {
+    return last_error_;
+}
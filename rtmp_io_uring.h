@@ -0,0 +1,70 @@
+#ifndef RTMP_IO_URING_H
+#define RTMP_IO_URING_H
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <string>
+#include <cstdint>
+
+// 最小的io_uring封装，直接使用系统调用(不依赖liburing)。
+// 推流连接用它发送：sendmsg与链接超时(IORING_OP_LINK_TIMEOUT)一起提交，
+// 一次io_uring_enter完成提交和等待，完成事件直接从共享内存的完成队列读取。
+// socket注册为固定文件，内核处理请求时不再查找文件描述符。
+// 发送是同步的：每次调用只有一个请求在途，返回前收齐它的完成事件，系统调用次数与sendmsg相同。
+// 收益在于固定文件和不依赖SO_SNDTIMEO的写超时；多帧合并由调用者(写线程)负责。
+// 不支持io_uring的内核或被seccomp禁止时init()失败，调用者回退到sendmsg。
+// 非线程安全，调用者负责串行化。
+class RTMPIoUring {
+public:
+    RTMPIoUring();
+    ~RTMPIoUring();
+
+    bool init(unsigned entries);
+    void close();
+    bool isOpen() const;
+
+    // 注册固定文件，之后对该文件的请求通过固定文件表引用
+    bool registerFile(int fd);
+
+    // 在fd上发送msg，超时则取消；返回写入的字节数，失败返回-errno(超时为-ETIME)。
+    // 无法等待已提交请求的完成时关闭ring，isOpen()随后返回false
+    int sendmsg(int fd, const struct msghdr* msg, int flags, uint32_t timeout_ms);
+
+    const std::string& lastError() const;
+
+private:
+    RTMPIoUring(const RTMPIoUring&);
+    RTMPIoUring& operator=(const RTMPIoUring&);
+
+    struct io_uring_sqe* getSqe();
+    int submitAndWait(unsigned submit, unsigned wait);
+    bool peekCompletion(struct io_uring_cqe& cqe);
+
+    int ring_fd_;
+    bool fixed_file_;
+    int file_fd_;
+
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* cq_ring_;
+    size_t cq_ring_size_;
+    struct io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_array_;
+    unsigned sq_pending_;           // 已填写但尚未提交的请求数
+
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    struct io_uring_cqe* cqes_;
+
+    uint64_t next_user_data_;       // 每次sendmsg占用两个：发送请求和链接超时
+
+    std::string last_error_;
+};
+
+#endif // RTMP_IO_URING_H
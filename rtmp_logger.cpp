@@ -91,7 +91,11 @@ void RTMPClient::logInternal(spdlog::level::level_enum level, const char* file,
     
     // 使用spdlog的source_loc来设置文件名和行号
     spdlog::source_loc loc{filename, line, ""};
-    g_logger->log(loc, level, message);
+    if (log_tag_.empty()) {
+        g_logger->log(loc, level, message);
+    } else {
+        g_logger->log(loc, level, log_tag_ + message);
+    }
 }
 
 
@@ -146,5 +150,5 @@ void RTMPClient::logInternalF(spdlog::level::level_enum level, const char* file,
     
     // 使用spdlog的source_loc来设置文件名和行号
     spdlog::source_loc loc{filename, line, ""};
-    g_logger->log(loc, level, std::string(buffer.data()));
+    g_logger->log(loc, level, log_tag_ + std::string(buffer.data()));
 }
@@ -28,4 +28,7 @@ class RTMPClient;
 #define RTMP_LOG_DEBUG_F(client, format, ...) \
     (client).logInternalF(spdlog::level::debug, __FILE__, __LINE__, format, ##__VA_ARGS__)
 
+#define RTMP_LOG_WARN_F(client, format, ...) \
+    (client).logInternalF(spdlog::level::warn, __FILE__, __LINE__, format, ##__VA_ARGS__)
+
 #endif // RTMP_LOGGER_H
\ No newline at end of file
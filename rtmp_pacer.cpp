@@ -0,0 +1,131 @@
+#include "rtmp_pacer.h"
+#include <time.h>
+#include <errno.h>
+
+// 超过该范围的时间戳跳变视为不连续，重新建立时间基准
+static const int32_t MAX_FORWARD_JUMP_MS = 10000;
+static const int32_t MAX_BACKWARD_JUMP_MS = 1000;
+
+// 快速启动最多突发的媒体时长，纯音频或GOP过长时在此结束
+static const int64_t MAX_FAST_START_MS = 10000;
+
+RTMPPacer::RTMPPacer()
+    : lead_ns_(0)
+    , max_catchup_ns_(1000LL * 1000000)
+    , anchored_(false)
+    , anchor_wall_ns_(0)
+    , anchor_media_ms_(0)
+    , media_ms_(0)
+    , last_timestamp_(0)
+    , resyncs_(0)
+    , fast_start_(false)
+    , fast_start_lead_ms_(0)
+    , burst_active_(false)
+    , burst_keyframes_(0)
+    , burst_end_ms_(0) {
+}
+
+void RTMPPacer::configure(uint32_t lead_ms, uint32_t max_catchup_ms) {
+    lead_ns_ = static_cast<int64_t>(lead_ms) * 1000000;
+    max_catchup_ns_ = static_cast<int64_t>(max_catchup_ms) * 1000000;
+}
+
+void RTMPPacer::setFastStart(bool enabled, uint32_t lead_ms) {
+    fast_start_ = enabled;
+    fast_start_lead_ms_ = lead_ms;
+    burst_active_ = enabled;
+}
+
+void RTMPPacer::reset() {
+    anchored_ = false;
+    anchor_wall_ns_ = 0;
+    anchor_media_ms_ = 0;
+    media_ms_ = 0;
+    last_timestamp_ = 0;
+    resyncs_ = 0;
+    burst_active_ = fast_start_;
+    burst_keyframes_ = 0;
+    burst_end_ms_ = 0;
+}
+
+int64_t RTMPPacer::nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+std::chrono::steady_clock::time_point RTMPPacer::toTimePoint(int64_t ns) {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+int64_t RTMPPacer::schedule(uint32_t timestamp, bool keyframe) {
+    int64_t now = nowNs();
+
+    if (!anchored_) {
+        anchored_ = true;
+        anchor_wall_ns_ = now;
+        anchor_media_ms_ = media_ms_;
+        last_timestamp_ = timestamp;
+    }
+
+    // 32位差值能正确处理时间戳回绕
+    int32_t delta = static_cast<int32_t>(timestamp - last_timestamp_);
+    last_timestamp_ = timestamp;
+
+    if (delta > MAX_FORWARD_JUMP_MS || delta < -MAX_BACKWARD_JUMP_MS) {
+        anchor_wall_ns_ = now;
+        anchor_media_ms_ = media_ms_;
+        resyncs_++;
+    } else {
+        media_ms_ += delta;
+    }
+
+    if (burst_active_) {
+        // 第二个关键帧标志第一个GOP完整，突发到它之后再加提前量为止
+        if (keyframe && ++burst_keyframes_ == 2) {
+            burst_end_ms_ = media_ms_ + fast_start_lead_ms_;
+        }
+        bool done = (burst_keyframes_ >= 2) ? media_ms_ >= burst_end_ms_
+                                             : media_ms_ - anchor_media_ms_ >= MAX_FAST_START_MS;
+        if (!done) {
+            return now;
+        }
+        // 突发结束，当前标签作为新的时间基准按时发送
+        burst_active_ = false;
+        anchor_wall_ns_ = now;
+        anchor_media_ms_ = media_ms_;
+    }
+
+    int64_t due = anchor_wall_ns_ + (media_ms_ - anchor_media_ms_) * 1000000;
+
+    // 落后超过追赶上限时后移时间基准，只突发发送上限以内的数据
+    int64_t late = now - due;
+    if (late > max_catchup_ns_) {
+        anchor_wall_ns_ += late - max_catchup_ns_;
+        due = now - max_catchup_ns_;
+        resyncs_++;
+    }
+
+    return due - lead_ns_;
+}
+
+int64_t RTMPPacer::waitUntil(int64_t deadline_ns) const {
+    struct timespec deadline;
+    deadline.tv_sec = deadline_ns / 1000000000;
+    deadline.tv_nsec = deadline_ns % 1000000000;
+
+    // 绝对时刻睡眠被信号中断后可以原样重试
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+    }
+
+    return (nowNs() - deadline_ns) / 1000;
+}
+
+bool RTMPPacer::inFastStart() const {
+    return burst_active_;
+}
+
+uint64_t RTMPPacer::resyncs() const {
+    return resyncs_;
+}
@@ -0,0 +1,57 @@
+#ifndef RTMP_PACER_H
+#define RTMP_PACER_H
+
+#include <cstdint>
+#include <chrono>
+
+// 按媒体时间戳实时发送的节奏控制器，每个推流会话一个实例。
+// 发送时刻 = 时间基准 + 媒体时长 - 提前量，使用CLOCK_MONOTONIC绝对时刻，
+// 睡眠误差和处理耗时不会累积。
+// - 停顿(网络阻塞、磁盘慢)之后最多以线速追赶max_catchup_ms的媒体数据，
+//   落后更多时把时间基准后移，避免恢复后长时间突发
+// - 时间戳大幅跳变(向前超过10秒或向后超过1秒)时重新建立时间基准
+// - 快速启动：开头的元数据、序列头和第一个完整GOP(再加提前量)立即发送，
+//   之后以当前时刻重新建立时间基准，时间戳不变
+class RTMPPacer {
+public:
+    RTMPPacer();
+
+    void configure(uint32_t lead_ms, uint32_t max_catchup_ms);
+    void setFastStart(bool enabled, uint32_t lead_ms);
+    void reset();
+
+    // 计算标签的计划发送时刻(CLOCK_MONOTONIC纳秒)，每个标签按顺序调用一次；
+    // 第一次调用以当前时刻为时间基准。快速启动阶段返回当前时刻
+    int64_t schedule(uint32_t timestamp, bool keyframe = false);
+
+    // 是否仍处于快速启动阶段(最近一次schedule的标签属于突发部分)
+    bool inFastStart() const;
+
+    // 阻塞到计划时刻，返回唤醒时刻晚于计划时刻的微秒数
+    int64_t waitUntil(int64_t deadline_ns) const;
+
+    uint64_t resyncs() const;
+
+    static int64_t nowNs();
+    // libstdc++的steady_clock基于CLOCK_MONOTONIC，可以直接换算
+    static std::chrono::steady_clock::time_point toTimePoint(int64_t ns);
+
+private:
+    int64_t lead_ns_;
+    int64_t max_catchup_ns_;
+
+    bool anchored_;
+    int64_t anchor_wall_ns_;        // 时间基准对应的墙钟时刻
+    int64_t anchor_media_ms_;       // 时间基准对应的媒体时间
+    int64_t media_ms_;              // 累计媒体时间，不受32位时间戳回绕影响
+    uint32_t last_timestamp_;
+    uint64_t resyncs_;
+
+    bool fast_start_;
+    int64_t fast_start_lead_ms_;
+    bool burst_active_;
+    uint32_t burst_keyframes_;
+    int64_t burst_end_ms_;          // 第二个关键帧的媒体时间加提前量，确定后有效
+};
+
+#endif // RTMP_PACER_H
@@ -0,0 +1,357 @@
+#include "rtmp_resolver.h"
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <resolv.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+
+int ResolvedAddress::family() const {
+    return addr.ss_family;
+}
+
+void ResolvedAddress::setPort(int port) {
+    if (addr.ss_family == AF_INET) {
+        reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port = htons(static_cast<uint16_t>(port));
+    } else if (addr.ss_family == AF_INET6) {
+        reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port = htons(static_cast<uint16_t>(port));
+    }
+}
+
+std::string ResolvedAddress::host() const {
+    char text[INET6_ADDRSTRLEN] = {0};
+    if (addr.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in*>(&addr)->sin_addr, text, sizeof(text));
+    } else if (addr.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6*>(&addr)->sin6_addr, text, sizeof(text));
+    }
+    return text;
+}
+
+std::string ResolvedAddress::toString() const {
+    if (addr.ss_family == AF_INET) {
+        return host() + ":" + std::to_string(ntohs(reinterpret_cast<const struct sockaddr_in*>(&addr)->sin_port));
+    }
+    if (addr.ss_family == AF_INET6) {
+        return "[" + host() + "]:" + std::to_string(ntohs(reinterpret_cast<const struct sockaddr_in6*>(&addr)->sin6_port));
+    }
+    return "";
+}
+
+// ========== RTMPResolveRequest ==========
+
+RTMPResolveRequest::RTMPResolveRequest()
+    : event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    , done_(false)
+    , success_(false)
+    , from_cache_(false) {
+}
+
+RTMPResolveRequest::~RTMPResolveRequest() {
+    if (event_fd_ >= 0) {
+        close(event_fd_);
+    }
+}
+
+int RTMPResolveRequest::eventFd() const {
+    return event_fd_;
+}
+
+bool RTMPResolveRequest::isDone() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_;
+}
+
+bool RTMPResolveRequest::wait(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return done_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return done_; });
+}
+
+bool RTMPResolveRequest::succeeded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return success_;
+}
+
+const std::vector<ResolvedAddress>& RTMPResolveRequest::addresses() const {
+    return addresses_;
+}
+
+const std::string& RTMPResolveRequest::error() const {
+    return error_;
+}
+
+bool RTMPResolveRequest::fromCache() const {
+    return from_cache_;
+}
+
+void RTMPResolveRequest::complete(bool success, const std::vector<ResolvedAddress>& addresses,
+                                  const std::string& error, bool from_cache) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        success_ = success;
+        addresses_ = addresses;
+        error_ = error;
+        from_cache_ = from_cache;
+        done_ = true;
+    }
+    done_cv_.notify_all();
+    if (event_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t n = write(event_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+// ========== RTMPResolver ==========
+
+// 查询type类型记录的最小TTL(包括CNAME链)，没有记录时返回false
+static bool queryRecordTTL(const std::string& host, int type, uint32_t& ttl) {
+    struct __res_state state;
+    memset(&state, 0, sizeof(state));
+    if (res_ninit(&state) != 0) {
+        return false;
+    }
+
+    unsigned char answer[4096];
+    int length = res_nsearch(&state, host.c_str(), ns_c_in, type, answer, sizeof(answer));
+    res_nclose(&state);
+    if (length <= 0) {
+        return false;
+    }
+
+    ns_msg msg;
+    if (ns_initparse(answer, length, &msg) < 0) {
+        return false;
+    }
+    bool found = false;
+    int count = ns_msg_count(msg, ns_s_an);
+    for (int i = 0; i < count; ++i) {
+        ns_rr rr;
+        if (ns_parserr(&msg, ns_s_an, i, &rr) < 0) {
+            continue;
+        }
+        uint32_t record_ttl = ns_rr_ttl(rr);
+        ttl = found ? std::min(ttl, record_ttl) : record_ttl;
+        found = true;
+    }
+    return found;
+}
+
+RTMPResolver& RTMPResolver::instance() {
+    // 后台解析线程可能在进程退出时仍在运行，实例不析构
+    static RTMPResolver* resolver = new RTMPResolver();
+    return *resolver;
+}
+
+RTMPResolver::RTMPResolver()
+    : cache_hits_(0)
+    , cache_misses_(0) {
+}
+
+bool RTMPResolver::parseLiteral(const std::string& host, ResolvedAddress& address) {
+    memset(&address.addr, 0, sizeof(address.addr));
+    struct sockaddr_in* v4 = reinterpret_cast<struct sockaddr_in*>(&address.addr);
+    if (inet_pton(AF_INET, host.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        address.length = sizeof(struct sockaddr_in);
+        return true;
+    }
+    struct sockaddr_in6* v6 = reinterpret_cast<struct sockaddr_in6*>(&address.addr);
+    if (inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        address.length = sizeof(struct sockaddr_in6);
+        return true;
+    }
+    return false;
+}
+
+std::shared_ptr<RTMPResolveRequest> RTMPResolver::resolve(const std::string& host, int port,
+                                                          const ResolveOptions& options) {
+    std::shared_ptr<RTMPResolveRequest> request = std::make_shared<RTMPResolveRequest>();
+
+    ResolvedAddress literal;
+    if (parseLiteral(host, literal)) {
+        literal.setPort(port);
+        request->complete(true, std::vector<ResolvedAddress>(1, literal), "", false);
+        return request;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = cache_.find(host);
+    if (it != cache_.end() && std::chrono::steady_clock::now() < it->second.expires) {
+        cache_hits_++;
+        std::vector<ResolvedAddress> addresses = orderedLocked(it->second, port);
+        lock.unlock();
+        request->complete(true, addresses, "", true);
+        return request;
+    }
+    cache_misses_++;
+
+    Waiter waiter;
+    waiter.request = request;
+    waiter.port = port;
+    std::vector<Waiter>& waiters = in_flight_[host];
+    waiters.push_back(waiter);
+    if (waiters.size() == 1) {
+        std::thread(&RTMPResolver::lookupThread, this, host, options).detach();
+    }
+    return request;
+}
+
+void RTMPResolver::lookupThread(std::string host, ResolveOptions options) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    struct addrinfo* result = nullptr;
+    int status = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+
+    CacheEntry entry;
+    std::string error;
+    bool has_v4 = false;
+    bool has_v6 = false;
+    if (status != 0) {
+        error = "Failed to resolve " + host + ": " + gai_strerror(status);
+    } else {
+        for (struct addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+            if ((ai->ai_family != AF_INET && ai->ai_family != AF_INET6) ||
+                ai->ai_addrlen > sizeof(struct sockaddr_storage)) {
+                continue;
+            }
+            ResolvedAddress address;
+            memset(&address.addr, 0, sizeof(address.addr));
+            memcpy(&address.addr, ai->ai_addr, ai->ai_addrlen);
+            address.length = ai->ai_addrlen;
+            // getaddrinfo可能对同一地址返回多项
+            bool duplicate = false;
+            for (const auto& existing : entry.addresses) {
+                duplicate = duplicate || (existing.length == address.length &&
+                                          memcmp(&existing.addr, &address.addr, address.length) == 0);
+            }
+            if (!duplicate) {
+                entry.addresses.push_back(address);
+                has_v4 = has_v4 || ai->ai_family == AF_INET;
+                has_v6 = has_v6 || ai->ai_family == AF_INET6;
+            }
+        }
+        freeaddrinfo(result);
+        if (entry.addresses.empty()) {
+            error = "No IPv4/IPv6 address for " + host;
+        }
+    }
+
+    // 先按默认TTL缓存并唤醒等待者，连接不等待下面的DNS查询
+    uint32_t default_ttl = std::min(options.default_ttl_s, options.max_ttl_s);
+    TimePoint resolved_at = std::chrono::steady_clock::now();
+    entry.expires = resolved_at + std::chrono::seconds(default_ttl);
+
+    std::vector<Waiter> waiters;
+    std::vector<std::vector<ResolvedAddress> > results;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error.empty() && default_ttl > 0) {
+            cache_[host] = entry;
+        }
+        waiters.swap(in_flight_[host]);
+        in_flight_.erase(host);
+        for (const auto& waiter : waiters) {
+            results.push_back(error.empty() ? orderedLocked(entry, waiter.port) : std::vector<ResolvedAddress>());
+        }
+    }
+
+    for (size_t i = 0; i < waiters.size(); ++i) {
+        waiters[i].request->complete(error.empty(), results[i], error, false);
+    }
+    if (!error.empty()) {
+        return;
+    }
+
+    // getaddrinfo不返回TTL，单独查询DNS记录，只用于调整缓存的过期时间；
+    // 来自hosts文件等的名字没有记录，保持默认值
+    uint32_t ttl = options.default_ttl_s;
+    uint32_t record_ttl = 0;
+    bool found = false;
+    if (has_v4 && queryRecordTTL(host, ns_t_a, record_ttl)) {
+        ttl = record_ttl;
+        found = true;
+    }
+    if (has_v6 && queryRecordTTL(host, ns_t_aaaa, record_ttl)) {
+        ttl = found ? std::min(ttl, record_ttl) : record_ttl;
+    }
+    ttl = std::min(ttl, options.max_ttl_s);
+    if (ttl == default_ttl) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(host);
+    if (it != cache_.end() && it->second.expires != entry.expires) {
+        // 已被之后的查询替换
+        return;
+    }
+    if (ttl == 0) {
+        if (it != cache_.end()) {
+            cache_.erase(it);
+        }
+    } else if (it != cache_.end()) {
+        // 保留期间记录的连接失败
+        it->second.expires = resolved_at + std::chrono::seconds(ttl);
+    } else {
+        entry.expires = resolved_at + std::chrono::seconds(ttl);
+        cache_[host] = entry;
+    }
+}
+
+std::vector<ResolvedAddress> RTMPResolver::orderedLocked(const CacheEntry& entry, int port) const {
+    // 按RFC 8305交替两个地址族：第一个地址的地址族优先
+    std::vector<ResolvedAddress> first;
+    std::vector<ResolvedAddress> second;
+    int first_family = entry.addresses.empty() ? AF_UNSPEC : entry.addresses[0].family();
+    for (const auto& address : entry.addresses) {
+        (address.family() == first_family ? first : second).push_back(address);
+    }
+    std::vector<ResolvedAddress> interleaved;
+    for (size_t i = 0; i < first.size() || i < second.size(); ++i) {
+        if (i < first.size()) interleaved.push_back(first[i]);
+        if (i < second.size()) interleaved.push_back(second[i]);
+    }
+
+    // 最近失败的地址排在最后，保持其余地址的相对顺序
+    std::stable_partition(interleaved.begin(), interleaved.end(), [&entry](const ResolvedAddress& address) {
+        return entry.failures.find(address.host()) == entry.failures.end();
+    });
+    for (auto& address : interleaved) {
+        address.setPort(port);
+    }
+    return interleaved;
+}
+
+void RTMPResolver::reportFailure(const std::string& host, const ResolvedAddress& address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(host);
+    if (it != cache_.end()) {
+        it->second.failures[address.host()] = std::chrono::steady_clock::now();
+    }
+}
+
+void RTMPResolver::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.clear();
+}
+
+uint64_t RTMPResolver::cacheHits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_hits_;
+}
+
+uint64_t RTMPResolver::cacheMisses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_misses_;
+}
@@ -0,0 +1,119 @@
+#ifndef RTMP_RESOLVER_H
+#define RTMP_RESOLVER_H
+
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+// 解析得到的一个服务器地址(IPv4或IPv6)
+struct ResolvedAddress {
+    struct sockaddr_storage addr;
+    socklen_t length = 0;
+
+    int family() const;
+    void setPort(int port);
+    std::string toString() const;       // IPv6地址带方括号，如[2001:db8::1]:1935
+    std::string host() const;           // 不带端口和方括号
+};
+
+// 缓存有效期：DNS记录没有TTL(来自hosts文件等)时使用default_ttl_s，记录的TTL不超过max_ttl_s
+struct ResolveOptions {
+    uint32_t default_ttl_s = 60;
+    uint32_t max_ttl_s = 300;
+};
+
+// 一次解析请求。完成时写入eventFd()，事件驱动模式把它加入epoll等待，阻塞模式调用wait()
+class RTMPResolveRequest {
+public:
+    RTMPResolveRequest();
+    ~RTMPResolveRequest();
+
+    int eventFd() const;
+    bool isDone() const;
+    // 等待解析完成，超时返回false
+    bool wait(int timeout_ms);
+
+    // 以下结果在完成之后有效
+    bool succeeded() const;
+    const std::vector<ResolvedAddress>& addresses() const;
+    const std::string& error() const;
+    bool fromCache() const;
+
+private:
+    RTMPResolveRequest(const RTMPResolveRequest&);
+    RTMPResolveRequest& operator=(const RTMPResolveRequest&);
+
+    friend class RTMPResolver;
+    void complete(bool success, const std::vector<ResolvedAddress>& addresses,
+                  const std::string& error, bool from_cache);
+
+    int event_fd_;
+    mutable std::mutex mutex_;
+    std::condition_variable done_cv_;
+    bool done_;
+    bool success_;
+    bool from_cache_;
+    std::vector<ResolvedAddress> addresses_;
+    std::string error_;
+};
+
+// 进程内共享的名字解析器。
+// - IP字面量直接返回，不查询也不缓存
+// - 其他主机名在后台线程上用getaddrinfo解析(遵循hosts文件和nsswitch)，
+//   再查询A/AAAA记录的TTL决定缓存时长；同一主机名同时只有一次查询，其余请求等待其结果
+// - 返回的地址按RFC 8305交替排列两个地址族，首选getaddrinfo(RFC 6724)排序的第一个地址的地址族；
+//   最近连接失败的地址排在最后，直到缓存过期
+// 线程安全。
+class RTMPResolver {
+public:
+    static RTMPResolver& instance();
+
+    // 返回的请求在字面量地址或缓存命中时已经完成
+    std::shared_ptr<RTMPResolveRequest> resolve(const std::string& host, int port,
+                                                const ResolveOptions& options);
+
+    // 连接该地址失败，之后的解析结果把它排在后面
+    void reportFailure(const std::string& host, const ResolvedAddress& address);
+
+    void clear();
+    uint64_t cacheHits() const;
+    uint64_t cacheMisses() const;
+
+    // 主机名是否为IPv4/IPv6字面量，是时填入address
+    static bool parseLiteral(const std::string& host, ResolvedAddress& address);
+
+private:
+    RTMPResolver();
+    RTMPResolver(const RTMPResolver&);
+    RTMPResolver& operator=(const RTMPResolver&);
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct CacheEntry {
+        std::vector<ResolvedAddress> addresses;     // 端口为0
+        TimePoint expires;
+        std::map<std::string, TimePoint> failures;  // 地址 -> 失败时刻
+    };
+
+    struct Waiter {
+        std::shared_ptr<RTMPResolveRequest> request;
+        int port;
+    };
+
+    void lookupThread(std::string host, ResolveOptions options);
+    std::vector<ResolvedAddress> orderedLocked(const CacheEntry& entry, int port) const;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, CacheEntry> cache_;
+    std::map<std::string, std::vector<Waiter> > in_flight_;
+    uint64_t cache_hits_;
+    uint64_t cache_misses_;
+};
+
+#endif // RTMP_RESOLVER_H
@@ -0,0 +1,133 @@
+#include "rtmp_socket_tuning.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <errno.h>
+#include <cstring>
+
+#ifndef SO_MAX_PACING_RATE
+#define SO_MAX_PACING_RATE 47
+#endif
+
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+
+bool RTMPSocketTuning::preset(const std::string& name, SocketTuning& tuning) {
+    SocketTuning result;
+    if (name == "default") {
+        // 全部保持系统默认
+    } else if (name == "low-latency") {
+        result.send_buffer_size = 64 * 1024;
+        result.tcp_nodelay = 1;
+        result.tcp_notsent_lowat = 16 * 1024;
+        result.tcp_cork = 0;
+    } else if (name == "high-throughput") {
+        result.send_buffer_size = 4 * 1024 * 1024;
+        result.recv_buffer_size = 256 * 1024;
+        result.tcp_nodelay = 0;
+        result.tcp_cork = 1;
+    } else if (name == "lossy-link") {
+        result.send_buffer_size = 1024 * 1024;
+        result.tcp_nodelay = 1;
+        result.tcp_notsent_lowat = 128 * 1024;
+        result.tcp_cork = 0;
+        result.tcp_congestion = "bbr";
+    } else {
+        return false;
+    }
+    tuning = result;
+    return true;
+}
+
+void RTMPSocketTuning::overlay(SocketTuning& tuning, const SocketTuning& overrides) {
+    if (overrides.send_buffer_size >= 0) tuning.send_buffer_size = overrides.send_buffer_size;
+    if (overrides.recv_buffer_size >= 0) tuning.recv_buffer_size = overrides.recv_buffer_size;
+    if (overrides.tcp_nodelay >= 0) tuning.tcp_nodelay = overrides.tcp_nodelay;
+    if (overrides.tcp_notsent_lowat >= 0) tuning.tcp_notsent_lowat = overrides.tcp_notsent_lowat;
+    if (overrides.tcp_cork >= 0) tuning.tcp_cork = overrides.tcp_cork;
+    if (overrides.max_pacing_rate >= 0) tuning.max_pacing_rate = overrides.max_pacing_rate;
+    if (!overrides.tcp_congestion.empty()) tuning.tcp_congestion = overrides.tcp_congestion;
+}
+
+static void setIntOption(int fd, int level, int option, int value, const char* name,
+                         std::vector<std::string>& warnings) {
+    if (setsockopt(fd, level, option, &value, sizeof(value)) < 0) {
+        warnings.push_back(std::string("Failed to set ") + name + "=" + std::to_string(value) +
+                           ": " + strerror(errno));
+    }
+}
+
+void RTMPSocketTuning::apply(int fd, const SocketTuning& tuning, AppliedSocketTuning& applied,
+                             std::vector<std::string>& warnings) {
+    if (tuning.send_buffer_size > 0) {
+        setIntOption(fd, SOL_SOCKET, SO_SNDBUF, tuning.send_buffer_size, "SO_SNDBUF", warnings);
+    }
+    if (tuning.recv_buffer_size > 0) {
+        setIntOption(fd, SOL_SOCKET, SO_RCVBUF, tuning.recv_buffer_size, "SO_RCVBUF", warnings);
+    }
+    if (tuning.tcp_nodelay >= 0) {
+        setIntOption(fd, IPPROTO_TCP, TCP_NODELAY, tuning.tcp_nodelay ? 1 : 0, "TCP_NODELAY", warnings);
+    }
+    if (tuning.tcp_notsent_lowat > 0) {
+        setIntOption(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, tuning.tcp_notsent_lowat, "TCP_NOTSENT_LOWAT", warnings);
+    }
+    if (tuning.max_pacing_rate > 0) {
+        // 64位内核接受64位的值，32位的值在4GB/s以下同样有效
+        uint64_t rate = static_cast<uint64_t>(tuning.max_pacing_rate);
+        if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) < 0) {
+            warnings.push_back("Failed to set SO_MAX_PACING_RATE=" + std::to_string(rate) + ": " + strerror(errno));
+        }
+    }
+    if (!tuning.tcp_congestion.empty()) {
+        // 算法模块未加载且无权限自动加载时返回ENOENT或EPERM
+        if (setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, tuning.tcp_congestion.c_str(),
+                       tuning.tcp_congestion.size()) < 0) {
+            warnings.push_back("Failed to set TCP_CONGESTION=" + tuning.tcp_congestion + ": " + strerror(errno));
+        }
+    }
+
+    applied.tcp_cork = tuning.tcp_cork > 0;
+    readBack(fd, applied);
+}
+
+void RTMPSocketTuning::readBack(int fd, AppliedSocketTuning& applied) {
+    int value = 0;
+    socklen_t len = sizeof(value);
+    if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &value, &len) == 0) {
+        applied.send_buffer_size = value;
+    }
+    len = sizeof(value);
+    if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &value, &len) == 0) {
+        applied.recv_buffer_size = value;
+    }
+    len = sizeof(value);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &value, &len) == 0) {
+        applied.tcp_nodelay = value != 0;
+    }
+    len = sizeof(value);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &value, &len) == 0) {
+        // 未设置时内核返回UINT_MAX
+        applied.tcp_notsent_lowat = value < 0 ? 0 : value;
+    }
+
+    uint64_t rate = 0;
+    len = sizeof(rate);
+    if (getsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, &len) == 0) {
+        // 不限速时为~0，32位返回值时为~0U
+        bool unlimited = (len == sizeof(uint32_t)) ? static_cast<uint32_t>(rate) == UINT32_MAX : rate == UINT64_MAX;
+        applied.max_pacing_rate = unlimited ? 0 : (len == sizeof(uint32_t) ? static_cast<uint32_t>(rate) : rate);
+    }
+
+    char name[16];
+    memset(name, 0, sizeof(name));
+    len = sizeof(name) - 1;
+    if (getsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, name, &len) == 0) {
+        applied.tcp_congestion = name;
+    }
+}
+
+bool RTMPSocketTuning::setCork(int fd, bool enabled) {
+    int value = enabled ? 1 : 0;
+    return setsockopt(fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0;
+}
@@ -0,0 +1,53 @@
+#ifndef RTMP_SOCKET_TUNING_H
+#define RTMP_SOCKET_TUNING_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// socket调优参数，-1(字符串为空)表示不设置，保持系统默认或预设的值
+struct SocketTuning {
+    int send_buffer_size = -1;          // SO_SNDBUF
+    int recv_buffer_size = -1;          // SO_RCVBUF
+    int tcp_nodelay = -1;               // TCP_NODELAY
+    int tcp_notsent_lowat = -1;         // TCP_NOTSENT_LOWAT，限制内核中尚未发送的数据量
+    int tcp_cork = -1;                  // 一次发送多条消息时用TCP_CORK合并成满长度报文段
+    int64_t max_pacing_rate = -1;       // SO_MAX_PACING_RATE(字节/秒)
+    std::string tcp_congestion;         // TCP_CONGESTION，如cubic、bbr
+};
+
+// 从内核读回的实际生效值
+struct AppliedSocketTuning {
+    std::string profile;
+    int send_buffer_size = 0;           // 内核返回的值(通常是设置值的两倍)
+    int recv_buffer_size = 0;
+    bool tcp_nodelay = false;
+    int tcp_notsent_lowat = 0;
+    bool tcp_cork = false;
+    uint64_t max_pacing_rate = 0;       // 0表示不限速
+    std::string tcp_congestion;
+};
+
+// socket调优预设：
+// - default: 不修改任何选项
+// - low-latency: 小发送缓冲区、TCP_NODELAY、低TCP_NOTSENT_LOWAT，积压留在应用队列里可以丢帧
+// - high-throughput: 大收发缓冲区，多条消息用TCP_CORK合并
+// - lossy-link: 较大发送缓冲区、TCP_NODELAY，拥塞控制使用对丢包不敏感的bbr
+// 缓冲区大小应在connect之前设置才会影响窗口扩大因子。
+class RTMPSocketTuning {
+public:
+    // 名称未知时返回false，tuning不变
+    static bool preset(const std::string& name, SocketTuning& tuning);
+
+    // 用overrides中显式设置的项覆盖tuning
+    static void overlay(SocketTuning& tuning, const SocketTuning& overrides);
+
+    // 逐项设置，失败的选项记入warnings后继续；完成后读回实际值
+    static void apply(int fd, const SocketTuning& tuning, AppliedSocketTuning& applied,
+                      std::vector<std::string>& warnings);
+    static void readBack(int fd, AppliedSocketTuning& applied);
+
+    static bool setCork(int fd, bool enabled);
+};
+
+#endif // RTMP_SOCKET_TUNING_H
@@ -0,0 +1,531 @@
+#include "rtmp_stream_manager.h"
+#include "rtmp_logger.h"
+#include <sys/stat.h>
+#include <cstring>
+
+RTMPStreamManager::RTMPStreamManager()
+    : watch_interval_ms_(2000)
+    , stats_interval_ms_(10000)
+    , exit_when_idle_(false)
+    , running_(false) {
+    memset(&manifest_mtime_, 0, sizeof(manifest_mtime_));
+    log_client_.setLogTag("manager");
+}
+
+RTMPStreamManager::~RTMPStreamManager() {
+    stop();
+}
+
+RTMPConfig RTMPStreamManager::buildConfig(ConfigParser& config) {
+    RTMPConfig rtmp_config;
+    rtmp_config.connect_timeout_ms = config.getInt("connection", "connect_timeout_ms", 10000);
+    rtmp_config.connect_attempt_delay_ms = config.getInt("connection", "connect_attempt_delay_ms", 250);
+    rtmp_config.dns_cache_ttl_s = config.getInt("connection", "dns_cache_ttl_s", 60);
+    rtmp_config.dns_max_ttl_s = config.getInt("connection", "dns_max_ttl_s", 300);
+    rtmp_config.read_timeout_ms = config.getInt("connection", "read_timeout_ms", 3000);
+    rtmp_config.write_timeout_ms = config.getInt("connection", "write_timeout_ms", 3000);
+    rtmp_config.max_retry_count = config.getInt("connection", "max_retry_count", 3);
+    rtmp_config.retry_interval_ms = config.getInt("connection", "retry_interval_ms", 1000);
+    rtmp_config.backup_url = config.getString("connection", "backup_url", "");
+    rtmp_config.standby_create_stream = config.getBool("connection", "standby_create_stream", false);
+    rtmp_config.reconnect_max_attempts = config.getInt("connection", "reconnect_max_attempts", 0);
+    rtmp_config.reconnect_initial_delay_ms = config.getInt("connection", "reconnect_initial_delay_ms", 500);
+    rtmp_config.reconnect_max_delay_ms = config.getInt("connection", "reconnect_max_delay_ms", 30000);
+    rtmp_config.reconnect_stable_ms = config.getInt("connection", "reconnect_stable_ms", 10000);
+    rtmp_config.enable_heartbeat = config.getBool("rtmp", "enable_heartbeat", true);
+    rtmp_config.heartbeat_interval_ms = config.getInt("rtmp", "heartbeat_interval_ms", 30000);
+    rtmp_config.chunk_size = config.getInt("rtmp", "chunk_size", 4096);
+    rtmp_config.pipelined_startup = config.getBool("rtmp", "pipelined_startup", false);
+    rtmp_config.release_stream = config.getBool("rtmp", "release_stream", false);
+    rtmp_config.enable_statistics = config.getBool("statistics", "enable_statistics", true);
+    rtmp_config.max_queue_size = config.getInt("performance", "max_queue_size", 1000);
+    rtmp_config.enable_send_queue = config.getBool("performance", "enable_send_queue", true);
+    rtmp_config.enable_frame_dropping = config.getBool("performance", "enable_frame_dropping", true);
+    rtmp_config.drop_disposable_watermark = config.getInt("performance", "drop_disposable_watermark", 50);
+    rtmp_config.drop_inter_watermark = config.getInt("performance", "drop_inter_watermark", 80);
+    rtmp_config.clip_start_ms = config.getInt("flv", "clip_start_ms", 0);
+    rtmp_config.clip_end_ms = config.getInt("flv", "clip_end_ms", 0);
+    rtmp_config.enable_flv_index = config.getBool("flv", "enable_index", true);
+    rtmp_config.loop_count = config.getInt("flv", "loop_count", 1);
+    rtmp_config.pacing_lead_ms = config.getInt("performance", "pacing_lead_ms", 0);
+    rtmp_config.pacing_max_catchup_ms = config.getInt("performance", "pacing_max_catchup_ms", 1000);
+    rtmp_config.fast_start = config.getBool("performance", "fast_start", false);
+    rtmp_config.fast_start_lead_ms = config.getInt("performance", "fast_start_lead_ms", 0);
+    rtmp_config.read_ahead_ms = config.getInt("performance", "read_ahead_ms", 0);
+    rtmp_config.checkpoint_file = config.getString("flv", "checkpoint_file", "");
+    rtmp_config.checkpoint_interval_ms = config.getInt("flv", "checkpoint_interval_ms", 5000);
+    rtmp_config.enable_io_uring = config.getBool("performance", "enable_io_uring", false);
+    rtmp_config.enable_aggregation = config.getBool("performance", "enable_aggregation", false);
+    rtmp_config.aggregate_window_ms = config.getInt("performance", "aggregate_window_ms", 50);
+    rtmp_config.aggregate_max_bytes = config.getInt("performance", "aggregate_max_bytes", 16384);
+    rtmp_config.congestion_policy = config.getString("performance", "congestion_policy", "off");
+    rtmp_config.congestion_sample_ms = config.getInt("performance", "congestion_sample_ms", 100);
+    rtmp_config.congestion_drop_disposable_ms = config.getInt("performance", "congestion_drop_disposable_ms", 500);
+    rtmp_config.congestion_drop_inter_ms = config.getInt("performance", "congestion_drop_inter_ms", 1500);
+    rtmp_config.socket_profile = config.getString("performance", "socket_profile", "default");
+    rtmp_config.socket_tuning.send_buffer_size = config.getInt("performance", "send_buffer_size", -1);
+    rtmp_config.socket_tuning.recv_buffer_size = config.getInt("performance", "recv_buffer_size", -1);
+    rtmp_config.socket_tuning.tcp_nodelay = config.getInt("performance", "tcp_nodelay", -1);
+    rtmp_config.socket_tuning.tcp_notsent_lowat = config.getInt("performance", "tcp_notsent_lowat", -1);
+    rtmp_config.socket_tuning.tcp_cork = config.getInt("performance", "tcp_cork", -1);
+    int pacing_rate_kbps = config.getInt("performance", "max_pacing_rate_kbps", -1);
+    rtmp_config.socket_tuning.max_pacing_rate = pacing_rate_kbps < 0 ? -1 : static_cast<int64_t>(pacing_rate_kbps) * 1000 / 8;
+    rtmp_config.socket_tuning.tcp_congestion = config.getString("performance", "tcp_congestion", "");
+    rtmp_config.enable_zerocopy = config.getBool("performance", "enable_zerocopy", false);
+    rtmp_config.zerocopy_threshold = config.getInt("performance", "zerocopy_threshold", 32768);
+    return rtmp_config;
+}
+
+const char* RTMPStreamManager::stateName(StreamState state) {
+    switch (state) {
+        case STREAM_WAITING: return "waiting";
+        case STREAM_RUNNING: return "running";
+        case STREAM_FINISHED: return "finished";
+        case STREAM_FAILED: return "failed";
+        case STREAM_STOPPED: return "stopped";
+    }
+    return "unknown";
+}
+
+std::string RTMPStreamManager::formatStatistics(const RTMPStatistics& stats) {
+    auto runtime = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - stats.start_time);
+
+    return "Runtime=" + std::to_string(runtime.count()) + "s" +
+           ", Sent=" + std::to_string(stats.bytes_sent / 1024) + "KB" +
+           ", Recv=" + std::to_string(stats.bytes_received / 1024) + "KB" +
+           ", AudioFrames=" + std::to_string(stats.audio_frames) +
+           ", VideoFrames=" + std::to_string(stats.video_frames) +
+           ", Dropped=" + std::to_string(stats.dropped_frames) +
+           "(Disposable=" + std::to_string(stats.dropped_disposable_frames) +
+           ", Inter=" + std::to_string(stats.dropped_inter_frames) + ")" +
+           ", QueueHighWater=" + std::to_string(stats.queue_high_water) +
+           ", PacingLate=" + std::to_string(stats.pacing_late_frames) +
+           "(Max=" + std::to_string(stats.pacing_max_late_us) + "us" +
+           ", Avg=" + std::to_string(stats.pacing_avg_late_us) + "us" +
+           ", Resyncs=" + std::to_string(stats.pacing_resyncs) + ")" +
+           ", ReadAhead=" + std::to_string(stats.read_ahead_buffered_ms) + "ms" +
+           "(LowBuffer=" + std::to_string(stats.read_ahead_low_buffer_events) + ")" +
+           ", SendCalls=" + std::to_string(stats.send_calls) +
+           ", Aggregates=" + std::to_string(stats.aggregate_messages) +
+           "(Tags=" + std::to_string(stats.aggregated_tags) + ")" +
+           ", Acks=" + std::to_string(stats.acks_sent) +
+           ", PingResponses=" + std::to_string(stats.ping_responses) +
+           ", TCP(RTT=" + std::to_string(stats.tcp_rtt_us) + "us" +
+           ", Cwnd=" + std::to_string(stats.tcp_cwnd) +
+           ", Rate=" + std::to_string(stats.tcp_delivery_rate * 8 / 1000) + "kbps" +
+           ", Drain=" + std::to_string(stats.tcp_drain_rate * 8 / 1000) + "kbps" +
+           ", OutQ=" + std::to_string(stats.tcp_send_queue_bytes / 1024) + "KB" +
+           ", Queued=" + std::to_string(stats.tcp_queued_ms) + "ms)" +
+           ", Congestion=" + std::to_string(stats.congestion_level) +
+           "(Changes=" + std::to_string(stats.congestion_level_changes) +
+           ", Drops=" + std::to_string(stats.congestion_dropped_frames) + ")" +
+           ", Socket(" + stats.socket_tuning.profile +
+           ", SndBuf=" + std::to_string(stats.socket_tuning.send_buffer_size / 1024) + "KB" +
+           ", RcvBuf=" + std::to_string(stats.socket_tuning.recv_buffer_size / 1024) + "KB" +
+           ", NoDelay=" + std::to_string(stats.socket_tuning.tcp_nodelay ? 1 : 0) +
+           ", NotSentLowat=" + std::to_string(stats.socket_tuning.tcp_notsent_lowat) +
+           ", Cork=" + std::to_string(stats.socket_tuning.tcp_cork ? 1 : 0) +
+           ", PacingRate=" + std::to_string(stats.socket_tuning.max_pacing_rate * 8 / 1000) + "kbps" +
+           ", CC=" + stats.socket_tuning.tcp_congestion + ")" +
+           ", ZeroCopy(Sends=" + std::to_string(stats.zerocopy_sends) +
+           ", Bytes=" + std::to_string(stats.zerocopy_bytes / 1024) + "KB" +
+           ", Done=" + std::to_string(stats.zerocopy_completions) +
+           ", Copied=" + std::to_string(stats.zerocopy_copied) +
+           ", Fallbacks=" + std::to_string(stats.zerocopy_fallbacks) +
+           ", Pending=" + std::to_string(stats.zerocopy_pending) + ")" +
+           ", Remote=" + stats.remote_address +
+           "(DNS=" + std::to_string(stats.dns_ms) + "ms" + (stats.dns_cached ? "(cached)" : "") +
+           ", Attempts=" + std::to_string(stats.connect_attempts) +
+           ", Connect=" + std::to_string(stats.connect_ms) + "ms" +
+           ", Startup=" + std::to_string(stats.startup_ms) + "ms)" +
+           ", Failover(Count=" + std::to_string(stats.failovers) +
+           ", LastMs=" + std::to_string(stats.failover_ms) +
+           ", StandbyConnects=" + std::to_string(stats.standby_connects) + ")" +
+           ", Reconnect(Count=" + std::to_string(stats.reconnects) +
+           ", Attempts=" + std::to_string(stats.reconnect_attempts) +
+           ", DisconnectedMs=" + std::to_string(stats.disconnected_ms) + ")" +
+           ", Checkpoint(Writes=" + std::to_string(stats.checkpoint_writes) +
+           ", Resumed=" + (stats.checkpoint_resumed ? "yes" : "no") + ")" +
+           ", AvgBitrate=" + std::to_string(stats.avg_bitrate / 1000) + "kbps";
+}
+
+bool RTMPStreamManager::start(const std::string& manifest_file) {
+    if (running_) {
+        return true;
+    }
+
+    manifest_file_ = manifest_file;
+
+    struct stat st;
+    if (stat(manifest_file_.c_str(), &st) == 0) {
+        manifest_mtime_ = st.st_mtim;
+    }
+
+    ConfigParser manifest;
+    std::vector<StreamJob> jobs;
+    if (!loadManifest(jobs, manifest)) {
+        return false;
+    }
+
+    watch_interval_ms_ = manifest.getInt("manager", "watch_interval_ms", 2000);
+    stats_interval_ms_ = manifest.getInt("manager", "stats_interval_ms", 10000);
+    exit_when_idle_ = manifest.getBool("manager", "exit_when_idle", false);
+    int threads = manifest.getInt("manager", "threads", 0);
+
+    loop_.reset(new RTMPEventLoop(threads > 0 ? threads : 0));
+    if (!loop_->start()) {
+        RTMP_LOG_ERROR(log_client_, "事件循环启动失败");
+        loop_.reset();
+        return false;
+    }
+
+    RTMP_LOG_INFO_F(log_client_, "多路推流启动: %zu路, %zu个工作线程",
+                    jobs.size(), loop_->threadCount());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    applyJobs(jobs);
+
+    monitor_thread_ = std::thread(&RTMPStreamManager::monitorThreadFunc, this);
+    return true;
+}
+
+void RTMPStreamManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    wakeup_.notify_all();
+
+    if (monitor_thread_.joinable()) {
+        monitor_thread_.join();
+    }
+
+    // 停止事件循环会结束所有会话，结束回调中将其标记为已停止
+    if (loop_) {
+        loop_->stop();
+        loop_.reset();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& pair : streams_) {
+        if (pair.second.state == STREAM_WAITING || pair.second.state == STREAM_RUNNING) {
+            pair.second.state = STREAM_STOPPED;
+        }
+    }
+}
+
+bool RTMPStreamManager::isActive() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+        return false;
+    }
+    if (!exit_when_idle_) {
+        return true;
+    }
+    for (const auto& pair : streams_) {
+        if (pair.second.state == STREAM_WAITING || pair.second.state == STREAM_RUNNING) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<StreamStatus> RTMPStreamManager::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<StreamStatus> result;
+    for (const auto& pair : streams_) {
+        const Stream& stream = pair.second;
+        StreamStatus status;
+        status.name = stream.job.name;
+        status.url = stream.job.url;
+        status.state = stream.state;
+        status.restarts = stream.restarts;
+        status.last_error = stream.last_error;
+        status.statistics = stream.client ? stream.client->getStatistics() : stream.statistics;
+        result.push_back(status);
+    }
+    return result;
+}
+
+bool RTMPStreamManager::loadManifest(std::vector<StreamJob>& jobs, ConfigParser& manifest) {
+    if (!manifest.loadConfig(manifest_file_)) {
+        RTMP_LOG_ERROR(log_client_, "无法加载推流清单: " + manifest_file_);
+        return false;
+    }
+
+    static const std::string prefix = "stream.";
+    for (const auto& section : manifest.getSections()) {
+        if (section.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+
+        StreamJob job;
+        job.name = section.substr(prefix.size());
+        job.settings = manifest.getSection(section);
+        job.url = manifest.getString(section, "url");
+        job.flv_file = manifest.getString(section, "flv_file");
+
+        if (!manifest.getBool(section, "enabled", true)) {
+            continue;
+        }
+        if (job.name.empty() || job.url.empty() || job.flv_file.empty()) {
+            RTMP_LOG_WARN(log_client_, "忽略不完整的推流配置: [" + section + "]");
+            continue;
+        }
+
+        // "节.键"形式的覆盖项叠加在全局配置之上
+        ConfigParser merged = manifest;
+        for (const auto& pair : job.settings) {
+            size_t dot = pair.first.find('.');
+            if (dot != std::string::npos && dot > 0) {
+                merged.setString(pair.first.substr(0, dot), pair.first.substr(dot + 1), pair.second);
+            }
+        }
+        job.config = buildConfig(merged);
+        // 推流清单的会话在事件循环中运行，不维护检查点；全局路径也会被所有推流共用
+        if (!job.config.checkpoint_file.empty()) {
+            RTMP_LOG_ERROR(log_client_, "推流清单不支持checkpoint_file，忽略推流: [" + section + "]");
+            continue;
+        }
+
+        jobs.push_back(job);
+    }
+
+    return true;
+}
+
+void RTMPStreamManager::applyJobs(const std::vector<StreamJob>& jobs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+
+    std::map<std::string, const StreamJob*> wanted;
+    for (const auto& job : jobs) {
+        wanted[job.name] = &job;
+    }
+
+    // 清单中已删除的推流
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        Stream& stream = it->second;
+        if (wanted.find(it->first) != wanted.end() || stream.removed) {
+            ++it;
+            continue;
+        }
+        if (stream.client) {
+            RTMP_LOG_INFO(log_client_, "停止已删除的推流: " + it->first);
+            stream.removed = true;
+            loop_->removeSession(stream.client);
+            ++it;
+        } else {
+            RTMP_LOG_INFO(log_client_, "移除推流: " + it->first);
+            it = streams_.erase(it);
+        }
+    }
+
+    // 新增和修改的推流
+    for (const auto& pair : wanted) {
+        const StreamJob& job = *pair.second;
+        auto it = streams_.find(job.name);
+
+        if (it == streams_.end()) {
+            RTMP_LOG_INFO(log_client_, "添加推流: " + job.name + " -> " + job.url);
+            Stream& stream = streams_[job.name];
+            stream.job = job;
+            stream.restart_at = now;
+            continue;
+        }
+
+        Stream& stream = it->second;
+        if (!stream.removed && stream.job.settings == job.settings) {
+            continue;
+        }
+
+        RTMP_LOG_INFO(log_client_, "推流配置已修改，重新启动: " + job.name);
+        stream.job = job;
+        stream.removed = false;
+        stream.restarts = 0;
+        stream.failures = 0;
+        if (stream.client) {
+            if (!stream.reload_pending) {
+                stream.reload_pending = true;
+                loop_->removeSession(stream.client);
+            }
+        } else {
+            stream.state = STREAM_WAITING;
+            stream.restart_at = now;
+        }
+    }
+
+    wakeup_.notify_all();
+}
+
+void RTMPStreamManager::launch(Stream& stream) {
+    std::shared_ptr<RTMPClient> client = std::make_shared<RTMPClient>();
+    client->setLogTag(stream.job.name);
+    client->setConfig(stream.job.config);
+
+    stream.client = client;
+    stream.generation++;
+    stream.state = STREAM_RUNNING;
+
+    std::string name = stream.job.name;
+    uint64_t generation = stream.generation;
+    bool added = loop_->addSession(client, stream.job.url, stream.job.flv_file,
+        [this, name, generation](RTMPClient& session, bool success) {
+            onSessionFinished(name, generation, session, success);
+        });
+
+    if (!added) {
+        stream.client.reset();
+        stream.state = STREAM_FAILED;
+        stream.last_error = "Event loop is not running";
+    }
+}
+
+void RTMPStreamManager::onSessionFinished(const std::string& name, uint64_t generation,
+                                          RTMPClient& client, bool success) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = streams_.find(name);
+    if (it == streams_.end() || it->second.generation != generation) {
+        return;
+    }
+
+    Stream& stream = it->second;
+    stream.statistics = client.getStatistics();
+    stream.last_error = success ? std::string() : client.getLastError();
+    stream.client.reset();  // 事件循环在回调返回后释放会话对象
+
+    if (stream.removed) {
+        RTMP_LOG_INFO(log_client_, "移除推流: " + name);
+        streams_.erase(it);
+        return;
+    }
+
+    if (!running_) {
+        stream.state = STREAM_STOPPED;
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (stream.reload_pending) {
+        stream.reload_pending = false;
+        stream.state = STREAM_WAITING;
+        stream.restart_at = now;
+        wakeup_.notify_all();
+        return;
+    }
+
+    if (success) {
+        stream.state = STREAM_FINISHED;
+        RTMP_LOG_INFO(log_client_, "推流完成: " + name + ", " + formatStatistics(stream.statistics));
+        return;
+    }
+
+    // 会话曾经推出媒体数据说明配置可用，重新计算连续失败次数
+    if (stream.statistics.audio_frames + stream.statistics.video_frames > 0) {
+        stream.failures = 0;
+    }
+
+    if (stream.failures < stream.job.config.max_retry_count) {
+        stream.failures++;
+        stream.restarts++;
+        stream.state = STREAM_WAITING;
+        stream.restart_at = now + std::chrono::milliseconds(stream.job.config.retry_interval_ms);
+        RTMP_LOG_WARN(log_client_, "推流中断: " + name + " (" + stream.last_error + "), " +
+                      std::to_string(stream.job.config.retry_interval_ms) + "ms后第" +
+                      std::to_string(stream.failures) + "次重试");
+        wakeup_.notify_all();
+    } else {
+        stream.state = STREAM_FAILED;
+        RTMP_LOG_ERROR(log_client_, "推流失败: " + name + " (" + stream.last_error + ")");
+    }
+}
+
+void RTMPStreamManager::monitorThreadFunc() {
+    // 间隔为0表示不启用，对应的时刻永远不会到期
+    auto start = std::chrono::steady_clock::now();
+    TimePoint next_watch = watch_interval_ms_ > 0 ? start + std::chrono::milliseconds(watch_interval_ms_)
+                                                  : TimePoint::max();
+    TimePoint next_stats = stats_interval_ms_ > 0 ? start + std::chrono::milliseconds(stats_interval_ms_)
+                                                  : TimePoint::max();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto now = std::chrono::steady_clock::now();
+
+        // 启动到期的推流，同时计算下一次唤醒时间
+        TimePoint wake_at = std::min(next_watch, next_stats);
+        for (auto& pair : streams_) {
+            Stream& stream = pair.second;
+            if (stream.state != STREAM_WAITING || stream.client) {
+                continue;
+            }
+            if (stream.restart_at <= now) {
+                launch(stream);
+            } else if (stream.restart_at < wake_at) {
+                wake_at = stream.restart_at;
+            }
+        }
+
+        if (watch_interval_ms_ > 0 && now >= next_watch) {
+            lock.unlock();
+            checkManifest();
+            lock.lock();
+            next_watch = now + std::chrono::milliseconds(watch_interval_ms_);
+            continue;
+        }
+
+        if (stats_interval_ms_ > 0 && now >= next_stats) {
+            lock.unlock();
+            logStatistics();
+            lock.lock();
+            next_stats = now + std::chrono::milliseconds(stats_interval_ms_);
+            continue;
+        }
+
+        if (wake_at == TimePoint::max()) {
+            wakeup_.wait(lock);
+        } else {
+            wakeup_.wait_until(lock, wake_at);
+        }
+    }
+}
+
+void RTMPStreamManager::checkManifest() {
+    struct stat st;
+    if (stat(manifest_file_.c_str(), &st) != 0) {
+        return;
+    }
+    if (st.st_mtim.tv_sec == manifest_mtime_.tv_sec && st.st_mtim.tv_nsec == manifest_mtime_.tv_nsec) {
+        return;
+    }
+    manifest_mtime_ = st.st_mtim;
+
+    RTMP_LOG_INFO(log_client_, "推流清单已修改，重新加载: " + manifest_file_);
+
+    // 加载失败时保持当前运行的推流不变
+    ConfigParser manifest;
+    std::vector<StreamJob> jobs;
+    if (!loadManifest(jobs, manifest)) {
+        return;
+    }
+    applyJobs(jobs);
+}
+
+void RTMPStreamManager::logStatistics() {
+    std::vector<StreamStatus> status = getStatus();
+    for (const auto& s : status) {
+        RTMP_LOG_INFO(log_client_, "STATS[" + s.name + "]: State=" + stateName(s.state) +
+                      ", Restarts=" + std::to_string(s.restarts) + ", " +
+                      formatStatistics(s.statistics));
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef RTMP_STREAM_MANAGER_H
+#define RTMP_STREAM_MANAGER_H
+
+#include "rtmp_client.h"
+#include "rtmp_event_loop.h"
+#include "config_parser.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+
+// 单路推流任务（来自任务清单中的一个[stream.名称]节）
+struct StreamJob {
+    std::string name;
+    std::string url;
+    std::string flv_file;
+    RTMPConfig config;
+    std::map<std::string, std::string> settings;    // 节内原始键值，用于检测变化
+};
+
+// 单路推流的运行状态
+enum StreamState {
+    STREAM_WAITING = 0,     // 等待启动或重启
+    STREAM_RUNNING,
+    STREAM_FINISHED,
+    STREAM_FAILED,
+    STREAM_STOPPED
+};
+
+struct StreamStatus {
+    std::string name;
+    std::string url;
+    StreamState state;
+    uint32_t restarts;
+    std::string last_error;
+    RTMPStatistics statistics;      // 最近一次会话的统计
+};
+
+// 多路推流管理器：在一个进程内运行任务清单中的所有推流，
+// 共享一个按CPU核数分片的RTMPEventLoop。每路推流失败后独立重启，
+// 清单文件修改后自动增删或重启对应的推流，无需重启进程。
+//
+// 清单格式(与rtmp_client.conf相同的INI格式):
+//   [manager]          threads, watch_interval_ms, stats_interval_ms, exit_when_idle
+//   [connection]等节   所有推流的默认配置
+//   [stream.名称]      url, flv_file, enabled, 以及"节.键"形式的覆盖项，如 rtmp.chunk_size=8192
+class RTMPStreamManager {
+public:
+    RTMPStreamManager();
+    ~RTMPStreamManager();
+
+    // 加载清单并启动所有推流
+    bool start(const std::string& manifest_file);
+    void stop();
+
+    // 是否还有需要运行的推流；exit_when_idle关闭时在stop()前始终为true
+    bool isActive() const;
+
+    std::vector<StreamStatus> getStatus() const;
+
+    // 从配置生成客户端参数，单路模式和清单模式共用
+    static RTMPConfig buildConfig(ConfigParser& config);
+
+    static const char* stateName(StreamState state);
+    static std::string formatStatistics(const RTMPStatistics& stats);
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct Stream {
+        StreamJob job;
+        std::shared_ptr<RTMPClient> client;     // 当前会话，未运行时为空
+        uint64_t generation = 0;                // 每次启动递增，过滤过期的结束回调
+        StreamState state = STREAM_WAITING;
+        uint32_t restarts = 0;                  // 累计重启次数
+        uint32_t failures = 0;                  // 连续失败次数，达到max_retry_count后放弃
+        TimePoint restart_at;
+        bool removed = false;                   // 已从清单删除，会话结束后移除
+        bool reload_pending = false;            // 清单已修改，会话结束后立即重启
+        std::string last_error;
+        RTMPStatistics statistics;
+    };
+
+    bool loadManifest(std::vector<StreamJob>& jobs, ConfigParser& manifest);
+    void applyJobs(const std::vector<StreamJob>& jobs);
+    void launch(Stream& stream);
+    void onSessionFinished(const std::string& name, uint64_t generation, RTMPClient& client, bool success);
+    void monitorThreadFunc();
+    void checkManifest();
+    void logStatistics();
+
+    std::string manifest_file_;
+    struct timespec manifest_mtime_;
+    int watch_interval_ms_;
+    int stats_interval_ms_;
+    bool exit_when_idle_;
+
+    std::unique_ptr<RTMPEventLoop> loop_;
+    std::map<std::string, Stream> streams_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::thread monitor_thread_;
+    bool running_;
+
+    RTMPClient log_client_;     // 仅用于管理器自身的日志输出
+};
+
+#endif // RTMP_STREAM_MANAGER_H
@@ -0,0 +1,229 @@
+#include "rtmp_zerocopy.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <poll.h>
+#include <errno.h>
+#include <chrono>
+#include <cstring>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+// 回收的缓冲区最多保留的个数
+static const size_t MAX_FREE_BUFFERS = 8;
+
+// 最先完成的这么多次发送都被内核拷贝时停用零拷贝
+static const uint64_t COPIED_DISABLE_SENDS = 16;
+
+// 按32位回绕比较通知编号
+static bool idBefore(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) < 0;
+}
+
+RTMPZeroCopy::RTMPZeroCopy()
+    : enabled_(false)
+    , next_id_(0)
+    , completed_upto_(0)
+    , sends_(0)
+    , bytes_(0)
+    , completions_(0)
+    , copied_(0)
+    , fallbacks_(0) {
+}
+
+bool RTMPZeroCopy::enable(int fd, std::string& error) {
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+        error = "Failed to enable SO_ZEROCOPY: " + std::string(strerror(errno));
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    enabled_ = true;
+    return true;
+}
+
+void RTMPZeroCopy::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enabled_ = false;
+    next_id_ = 0;
+    completed_upto_ = 0;
+    completed_ranges_.clear();
+    held_.clear();
+    sends_ = 0;
+    bytes_ = 0;
+    completions_ = 0;
+    copied_ = 0;
+    fallbacks_ = 0;
+}
+
+bool RTMPZeroCopy::isEnabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return enabled_;
+}
+
+void RTMPZeroCopy::onSent(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_id_++;
+    sends_++;
+    bytes_ += bytes;
+}
+
+void RTMPZeroCopy::onFallback() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fallbacks_++;
+}
+
+void RTMPZeroCopy::hold(std::vector<uint8_t>& buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    HeldBuffer held;
+    held.id = next_id_ - 1;
+    held.buffer.swap(buffer);
+    held_.push_back(std::move(held));
+
+    if (!free_.empty()) {
+        buffer.swap(free_.back());
+        free_.pop_back();
+    }
+    releaseLocked();
+}
+
+size_t RTMPZeroCopy::reap(int fd) {
+    size_t notifications = 0;
+    while (true) {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            // EAGAIN表示错误队列已空
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            bool recverr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                           (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+            if (!recverr) {
+                continue;
+            }
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+                continue;
+            }
+            // ee_info到ee_data是已完成的编号区间，相邻的通知可能被内核合并
+            completeLocked(err.ee_info, err.ee_data, (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+            notifications++;
+        }
+        releaseLocked();
+    }
+    return notifications;
+}
+
+bool RTMPZeroCopy::waitAll(int fd, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        reap(fd);
+        if (pending() == 0) {
+            return true;
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            return false;
+        }
+        // 错误队列非空时poll返回POLLERR
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = 0;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, static_cast<int>(remaining < 50 ? remaining : 50)) < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+void RTMPZeroCopy::completeLocked(uint32_t lo, uint32_t hi, bool copied) {
+    uint32_t count = hi - lo + 1;
+    completions_ += count;
+    if (copied) {
+        copied_ += count;
+    }
+    if (enabled_ && completions_ >= COPIED_DISABLE_SENDS && copied_ == completions_) {
+        enabled_ = false;
+    }
+
+    if (idBefore(hi, completed_upto_)) {
+        return;
+    }
+    if (idBefore(completed_upto_, lo)) {
+        completed_ranges_[lo] = hi;
+        return;
+    }
+    completed_upto_ = hi + 1;
+
+    // 合并之前乱序到达的区间
+    auto it = completed_ranges_.begin();
+    while (it != completed_ranges_.end() && !idBefore(completed_upto_, it->first)) {
+        if (!idBefore(it->second, completed_upto_)) {
+            completed_upto_ = it->second + 1;
+        }
+        it = completed_ranges_.erase(it);
+    }
+}
+
+void RTMPZeroCopy::releaseLocked() {
+    while (!held_.empty() && idBefore(held_.front().id, completed_upto_)) {
+        if (free_.size() < MAX_FREE_BUFFERS) {
+            held_.front().buffer.clear();
+            free_.push_back(std::move(held_.front().buffer));
+        }
+        held_.pop_front();
+    }
+}
+
+uint32_t RTMPZeroCopy::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t pending = next_id_ - completed_upto_;
+    for (const auto& range : completed_ranges_) {
+        pending -= range.second - range.first + 1;
+    }
+    return pending;
+}
+
+uint64_t RTMPZeroCopy::sends() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sends_;
+}
+
+uint64_t RTMPZeroCopy::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+uint64_t RTMPZeroCopy::completions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completions_;
+}
+
+uint64_t RTMPZeroCopy::copied() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return copied_;
+}
+
+uint64_t RTMPZeroCopy::fallbacks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fallbacks_;
+}
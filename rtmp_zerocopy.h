@@ -0,0 +1,84 @@
+#ifndef RTMP_ZEROCOPY_H
+#define RTMP_ZEROCOPY_H
+
+#include <sys/socket.h>
+#include <mutex>
+#include <map>
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+// MSG_ZEROCOPY发送的完成通知跟踪。
+// 内核对每次带MSG_ZEROCOPY且写入了数据的发送调用按顺序编号，数据被确认、页面引用释放后
+// 通过socket错误队列返回已完成的编号区间；在此之前被发送的内存不能修改或释放。
+// - 发送调用者在写入后调用onSent()，把引用了已发送数据的缓冲区交给hold()
+// - reap()非阻塞地读取错误队列，释放已完成发送所持有的缓冲区，供之后的hold()换出复用
+// - waitAll()在释放负载(如FLV映射)或关闭连接之前等待全部完成
+// 完成通知全部标记为内核拷贝时(回环接口、网卡不支持分散聚合)零拷贝只增加开销，
+// 最先完成的COPIED_DISABLE_SENDS次发送都被拷贝时自动停用，已发送的仍然跟踪到完成。
+// 错误队列非空时socket可读，读取控制消息的线程也要调用reap()，否则select会一直返回可读。
+// 线程安全。
+class RTMPZeroCopy {
+public:
+    RTMPZeroCopy();
+
+    // 在socket上启用SO_ZEROCOPY，内核不支持时返回false
+    bool enable(int fd, std::string& error);
+    void reset();
+    // 是否继续使用零拷贝发送，内核一直回退为拷贝时变为false
+    bool isEnabled() const;
+
+    // 一次带MSG_ZEROCOPY的发送写入了数据(包括部分写入)
+    void onSent(uint64_t bytes);
+    // 内核拒绝零拷贝(ENOBUFS，通知占用的内存超过optmem_max)，该次改为普通发送
+    void onFallback();
+
+    // 把buffer交给最近一次零拷贝发送持有，buffer换成一个可复用的空缓冲区
+    void hold(std::vector<uint8_t>& buffer);
+
+    // 读取错误队列中的全部完成通知，返回处理的通知数
+    size_t reap(int fd);
+    // 等待全部零拷贝发送完成，超时返回false
+    bool waitAll(int fd, int timeout_ms);
+
+    uint32_t pending() const;
+    uint64_t sends() const;
+    uint64_t bytes() const;
+    uint64_t completions() const;
+    uint64_t copied() const;        // 内核回退为拷贝的发送数(如回环接口或网卡不支持分散聚合)
+    uint64_t fallbacks() const;
+
+private:
+    RTMPZeroCopy(const RTMPZeroCopy&);
+    RTMPZeroCopy& operator=(const RTMPZeroCopy&);
+
+    void completeLocked(uint32_t lo, uint32_t hi, bool copied);
+    void releaseLocked();
+
+    mutable std::mutex mutex_;
+    bool enabled_;
+
+    uint32_t next_id_;              // 下一次零拷贝发送的通知编号
+    uint32_t completed_upto_;       // 此编号之前的发送全部完成
+    std::map<uint32_t, uint32_t> completed_ranges_;   // 乱序到达的完成区间[lo, hi]
+
+    struct HeldBuffer {
+        uint32_t id;                // 持有该缓冲区的最后一次发送
+        std::vector<uint8_t> buffer;
+    };
+    std::deque<HeldBuffer> held_;
+    std::vector<std::vector<uint8_t> > free_;
+
+    uint64_t sends_;
+    uint64_t bytes_;
+    uint64_t completions_;
+    uint64_t copied_;
+    uint64_t fallbacks_;
+};
+
+#endif // RTMP_ZEROCOPY_H
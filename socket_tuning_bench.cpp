@@ -0,0 +1,290 @@
+// socket调优预设对比工具：在本机起一个限速接收端，按固定帧率发送带时间戳的帧，
+// 统计每个预设下的吞吐量和帧延迟：总延迟从计划发送时刻算起，包含发送调用阻塞的时间；
+// 内核延迟从开始写入socket算起，即数据在内核发送队列中停留的时间。
+//
+// 用法: socket_tuning_bench [--duration 秒] [--bitrate kbps] [--sink-rate kbps] [--profile 名称]...
+// 接收端速率略高于平均码率时，关键帧突发会在内核发送队列中积压，可以看出缓冲区大小对延迟的影响。
+
+#include "rtmp_socket_tuning.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint32_t FRAME_HEADER_SIZE = 20;  // 4字节帧长 + 8字节计划发送时刻 + 8字节开始写入时刻(纳秒)
+const int FRAME_RATE = 30;
+const int GOP_FRAMES = 60;
+const int KEYFRAME_WEIGHT = 10;         // 关键帧大小是普通帧的倍数
+const int SINK_RECV_BUFFER = 32 * 1024;
+
+struct BenchOptions {
+    int duration_s = 5;
+    int bitrate_kbps = 4000;
+    int sink_rate_kbps = 6000;
+    std::vector<std::string> profiles;
+};
+
+struct BenchResult {
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    double elapsed_s = 0;
+    double latency_avg_ms = 0;
+    double latency_max_ms = 0;
+    double kernel_latency_avg_ms = 0;
+    double kernel_latency_max_ms = 0;
+    AppliedSocketTuning applied;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void writeU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (24 - 8 * i));
+}
+
+void writeI64(uint8_t* p, int64_t v) {
+    uint64_t u = static_cast<uint64_t>(v);
+    for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t>(u >> (56 - 8 * i));
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+int64_t readI64(const uint8_t* p) {
+    uint64_t u = 0;
+    for (int i = 0; i < 8; i++) u = (u << 8) | p[i];
+    return static_cast<int64_t>(u);
+}
+
+bool sendAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 按sink_rate_kbps限速读取，解析帧头并记录每帧延迟
+void sinkThread(int listen_fd, int sink_rate_kbps, BenchResult& result) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+
+    const size_t read_size = 4096;
+    const double bytes_per_ns = sink_rate_kbps * 1000.0 / 8 / 1e9;
+    std::vector<uint8_t> buffer;
+    size_t offset = 0;
+    double latency_sum_ms = 0;
+    double kernel_latency_sum_ms = 0;
+    int64_t start = nowNs();
+    uint8_t chunk[read_size];
+
+    while (true) {
+        // 读取速度不超过sink_rate_kbps
+        int64_t allowed_at = start + static_cast<int64_t>(result.bytes / bytes_per_ns);
+        int64_t now = nowNs();
+        if (allowed_at > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(allowed_at - now));
+        }
+
+        ssize_t n = recv(fd, chunk, read_size, 0);
+        if (n <= 0) {
+            break;
+        }
+        result.bytes += static_cast<uint64_t>(n);
+        buffer.insert(buffer.end(), chunk, chunk + n);
+
+        while (buffer.size() - offset >= FRAME_HEADER_SIZE) {
+            uint32_t frame_size = readU32(&buffer[offset]);
+            if (buffer.size() - offset < frame_size) {
+                break;
+            }
+            int64_t now_ns = nowNs();
+            double latency_ms = (now_ns - readI64(&buffer[offset + 4])) / 1e6;
+            double kernel_latency_ms = (now_ns - readI64(&buffer[offset + 12])) / 1e6;
+            latency_sum_ms += latency_ms;
+            kernel_latency_sum_ms += kernel_latency_ms;
+            result.latency_max_ms = std::max(result.latency_max_ms, latency_ms);
+            result.kernel_latency_max_ms = std::max(result.kernel_latency_max_ms, kernel_latency_ms);
+            result.frames++;
+            offset += frame_size;
+        }
+        if (offset > 0 && offset == buffer.size()) {
+            buffer.clear();
+            offset = 0;
+        }
+    }
+
+    result.elapsed_s = (nowNs() - start) / 1e9;
+    if (result.frames > 0) {
+        result.latency_avg_ms = latency_sum_ms / result.frames;
+        result.kernel_latency_avg_ms = kernel_latency_sum_ms / result.frames;
+    }
+    close(fd);
+}
+
+bool runProfile(const std::string& profile, const BenchOptions& options, BenchResult& result) {
+    SocketTuning tuning;
+    if (!RTMPSocketTuning::preset(profile, tuning)) {
+        std::cerr << "未知的预设: " << profile << std::endl;
+        return false;
+    }
+
+    // 接收端缓冲区设小，使积压留在发送端而不是被回环接口的大接收窗口吸收
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int sink_rcvbuf = SINK_RECV_BUFFER;
+    if (listen_fd >= 0) {
+        setsockopt(listen_fd, SOL_SOCKET, SO_RCVBUF, &sink_rcvbuf, sizeof(sink_rcvbuf));
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd, 1) < 0 || getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) < 0) {
+        std::cerr << "创建接收端失败: " << strerror(errno) << std::endl;
+        if (listen_fd >= 0) close(listen_fd);
+        return false;
+    }
+
+    std::thread sink(sinkThread, listen_fd, options.sink_rate_kbps, std::ref(result));
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    std::vector<std::string> warnings;
+    result.applied.profile = profile;
+    RTMPSocketTuning::apply(fd, tuning, result.applied, warnings);
+    for (const auto& warning : warnings) {
+        std::cerr << "[" << profile << "] " << warning << std::endl;
+    }
+
+    bool ok = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    if (!ok) {
+        std::cerr << "连接接收端失败: " << strerror(errno) << std::endl;
+    }
+
+    // 每帧一个视频帧加两个音频帧，cork开启时三者合并发送
+    const uint64_t bytes_per_gop = static_cast<uint64_t>(options.bitrate_kbps) * 1000 / 8 * GOP_FRAMES / FRAME_RATE;
+    const uint32_t inter_size = std::max<uint32_t>(FRAME_HEADER_SIZE,
+        static_cast<uint32_t>(bytes_per_gop / (GOP_FRAMES - 1 + KEYFRAME_WEIGHT)));
+    const uint32_t audio_size = 256;
+    const int64_t frame_interval_ns = 1000000000LL / FRAME_RATE;
+    const int total_frames = options.duration_s * FRAME_RATE;
+    std::vector<uint8_t> frame(static_cast<size_t>(inter_size) * KEYFRAME_WEIGHT, 0);
+    int64_t start = nowNs();
+
+    for (int i = 0; ok && i < total_frames; i++) {
+        int64_t due = start + i * frame_interval_ns;
+        int64_t now = nowNs();
+        if (due > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+        }
+
+        if (result.applied.tcp_cork) {
+            RTMPSocketTuning::setCork(fd, true);
+        }
+        uint32_t video_size = (i % GOP_FRAMES == 0) ? inter_size * KEYFRAME_WEIGHT : inter_size;
+        const uint32_t sizes[] = {video_size, audio_size, audio_size};
+        for (uint32_t size : sizes) {
+            writeU32(&frame[0], size);
+            writeI64(&frame[4], due);
+            writeI64(&frame[12], nowNs());
+            if (!sendAll(fd, &frame[0], size)) {
+                ok = false;
+                break;
+            }
+        }
+        if (result.applied.tcp_cork) {
+            RTMPSocketTuning::setCork(fd, false);
+        }
+    }
+
+    shutdown(fd, SHUT_WR);
+    sink.join();
+    close(fd);
+    close(listen_fd);
+    return ok;
+}
+
+void printUsage(const char* program) {
+    std::cout << "用法: " << program
+              << " [--duration 秒] [--bitrate kbps] [--sink-rate kbps] [--profile 名称]..." << std::endl;
+    std::cout << "默认对比 default、low-latency、high-throughput、lossy-link 四个预设" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--duration") {
+            options.duration_s = std::max(1, atoi(value.c_str()));
+        } else if (arg == "--bitrate") {
+            options.bitrate_kbps = std::max(100, atoi(value.c_str()));
+        } else if (arg == "--sink-rate") {
+            options.sink_rate_kbps = std::max(100, atoi(value.c_str()));
+        } else if (arg == "--profile") {
+            options.profiles.push_back(value);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.profiles.empty()) {
+        options.profiles = {"default", "low-latency", "high-throughput", "lossy-link"};
+    }
+
+    std::cout << "码率 " << options.bitrate_kbps << "kbps, 接收端 " << options.sink_rate_kbps
+              << "kbps, 时长 " << options.duration_s << "s" << std::endl;
+    for (const auto& profile : options.profiles) {
+        BenchResult result;
+        if (!runProfile(profile, options, result)) {
+            continue;
+        }
+        double throughput_kbps = result.elapsed_s > 0 ? result.bytes * 8 / 1000.0 / result.elapsed_s : 0;
+        std::cout << profile
+                  << ": 吞吐 " << static_cast<uint64_t>(throughput_kbps) << "kbps"
+                  << ", 帧数 " << result.frames
+                  << ", 总延迟 平均/最大 " << static_cast<int>(result.latency_avg_ms) << "/"
+                  << static_cast<int>(result.latency_max_ms) << "ms"
+                  << ", 内核延迟 平均/最大 " << static_cast<int>(result.kernel_latency_avg_ms) << "/"
+                  << static_cast<int>(result.kernel_latency_max_ms) << "ms"
+                  << " (SndBuf=" << result.applied.send_buffer_size / 1024 << "KB"
+                  << ", NoDelay=" << (result.applied.tcp_nodelay ? 1 : 0)
+                  << ", NotSentLowat=" << result.applied.tcp_notsent_lowat
+                  << ", Cork=" << (result.applied.tcp_cork ? 1 : 0)
+                  << ", CC=" << result.applied.tcp_congestion << ")" << std::endl;
+    }
+    return 0;
+}